@@ -0,0 +1,119 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <cmath>
+
+CameraPath::CameraPath(const std::vector<glm::vec3>& points) : points(points) {
+}
+
+int CameraPath::segment(float t, float& u) const {
+    float s = (t - std::floor(t)) * points.size();
+    int i = static_cast<int>(s);
+    u = s - i;
+    return i;
+}
+
+glm::vec3 CameraPath::position(float t) const {
+    float u;
+    int i = segment(t, u);
+    int n = static_cast<int>(points.size());
+    const glm::vec3& p0 = points[(i + n - 1) % n];
+    const glm::vec3& p1 = points[i % n];
+    const glm::vec3& p2 = points[(i + 1) % n];
+    const glm::vec3& p3 = points[(i + 2) % n];
+    return 0.5f * ((2.0f * p1) + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u * u
+        + (3.0f * p1 - p0 - 3.0f * p2 + p3) * u * u * u);
+}
+
+glm::vec3 CameraPath::direction(float t) const {
+    float u;
+    int i = segment(t, u);
+    int n = static_cast<int>(points.size());
+    const glm::vec3& p0 = points[(i + n - 1) % n];
+    const glm::vec3& p1 = points[i % n];
+    const glm::vec3& p2 = points[(i + 1) % n];
+    const glm::vec3& p3 = points[(i + 2) % n];
+    glm::vec3 tangent = 0.5f * ((p2 - p0) + 2.0f * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u
+        + 3.0f * (3.0f * p1 - p0 - 3.0f * p2 + p3) * u * u);
+    return glm::normalize(tangent);
+}
+
+CameraPath CameraPath::flyover() {
+    return CameraPath({
+        glm::vec3(0.0f, 500.0f, 0.0f),
+        glm::vec3(4000.0f, 700.0f, -2500.0f),
+        glm::vec3(9000.0f, 400.0f, -1000.0f),
+        glm::vec3(10000.0f, 900.0f, 4000.0f),
+        glm::vec3(6000.0f, 600.0f, 8000.0f),
+        glm::vec3(1000.0f, 1300.0f, 9000.0f),
+        glm::vec3(-3000.0f, 600.0f, 5000.0f),
+        glm::vec3(-2500.0f, 800.0f, 1500.0f)
+    });
+}
+
+namespace {
+
+void writeString(std::ostream& out, const std::string& s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (static_cast<unsigned char>(c) >= 0x20)
+            out << c;
+    }
+    out << '"';
+}
+
+// Mean, nearest-rank percentiles and maximum of one column of the frames
+void writeSummary(std::ostream& out, const char* name, std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    double sum = 0.0;
+    for (double v : values)
+        sum += v;
+    auto percentile = [&values](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+        return values[std::max<size_t>(rank, 1) - 1];
+    };
+
+    out << "  \"" << name << "\": { ";
+    if (values.empty()) {
+        out << "},\n";
+        return;
+    }
+    out << "\"mean\": " << sum / values.size()
+        << ", \"p50\": " << percentile(50.0)
+        << ", \"p90\": " << percentile(90.0)
+        << ", \"p99\": " << percentile(99.0)
+        << ", \"max\": " << values.back() << " },\n";
+}
+
+} // namespace
+
+void writeBenchmarkJson(std::ostream& out, const std::vector<BenchmarkFrame>& frames,
+    const std::string& renderer, const std::string& vertexFormat, int width, int height) {
+    std::vector<double> cpu, frame, gpu;
+    for (const BenchmarkFrame& f : frames) {
+        cpu.push_back(f.cpuMs);
+        frame.push_back(f.frameMs);
+        gpu.push_back(f.gpuMs);
+    }
+
+    out << "{\n  \"renderer\": ";
+    writeString(out, renderer);
+    out << ",\n  \"vertex_format\": ";
+    writeString(out, vertexFormat);
+    out << ",\n  \"width\": " << width << ",\n  \"height\": " << height
+        << ",\n  \"frames\": " << frames.size() << ",\n";
+    writeSummary(out, "cpu_ms", cpu);
+    writeSummary(out, "frame_ms", frame);
+    writeSummary(out, "gpu_ms", gpu);
+
+    out << "  \"per_frame\": [\n";
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const BenchmarkFrame& f = frames[i];
+        out << "    { \"cpu_ms\": " << f.cpuMs << ", \"frame_ms\": " << f.frameMs
+            << ", \"gpu_ms\": " << f.gpuMs << ", \"chunks_drawn\": " << f.chunksDrawn
+            << ", \"pending_chunks\": " << f.pendingChunks << ", \"props_drawn\": " << f.propsDrawn << " }"
+            << (i + 1 < frames.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
@@ -0,0 +1,48 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glm/glm.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Noise seed of the benchmark terrain, so every run flies over the same landscape
+const unsigned int BENCHMARK_SEED = 404;
+
+// Closed Catmull-Rom spline through camera positions. It is sampled by a
+// parameter in [0, 1) rather than by time, so a scripted flight visits the same
+// positions whatever the frame rate.
+class CameraPath {
+public:
+    explicit CameraPath(const std::vector<glm::vec3>& points);
+
+    glm::vec3 position(float t) const;
+    // Unit direction of travel at t
+    glm::vec3 direction(float t) const;
+
+    // Loop over the BENCHMARK_SEED terrain used by the --benchmark mode: high
+    // enough to clear every peak, with turns and climbs that sweep the view
+    // across new chunks
+    static CameraPath flyover();
+
+private:
+    std::vector<glm::vec3> points;
+
+    // Index of the segment t falls in and the position u in [0, 1) along it
+    int segment(float t, float& u) const;
+};
+
+struct BenchmarkFrame {
+    double cpuMs;      // update() and draw call submission
+    double frameMs;    // whole frame including buffer swap
+    double gpuMs;
+    int chunksDrawn;
+    int pendingChunks; // chunks still streaming in
+    int propsDrawn;
+};
+
+// Writes the run as JSON: context, percentile summaries and every frame
+void writeBenchmarkJson(std::ostream& out, const std::vector<BenchmarkFrame>& frames,
+    const std::string& renderer, const std::string& vertexFormat, int width, int height);
+
+#endif // BENCHMARK_H
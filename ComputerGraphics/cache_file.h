@@ -0,0 +1,46 @@
+#ifndef CACHE_FILE_H
+#define CACHE_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// Helpers shared by the on-disk caches (ProgramCache, TileCache and the text
+// atlas cache)
+
+const std::uint64_t FnvOffsetBasis = 14695981039346656037ULL;
+const std::uint64_t FnvPrime = 1099511628211ULL;
+
+// 64-bit FNV-1a over size bytes of data, continued from hash
+inline std::uint64_t fnv1a(const void* data, std::size_t size, std::uint64_t hash = FnvOffsetBasis) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FnvPrime;
+    }
+    return hash;
+}
+
+// Writes header then payload to path through a temporary file renamed over
+// it, so a crash never leaves a truncated entry. False if the file could not
+// be written.
+inline bool atomicWriteFile(const std::string& path, const void* header, std::size_t headerSize,
+    const void* payload, std::size_t payloadSize) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(static_cast<const char*>(header), headerSize);
+        file.write(static_cast<const char*>(payload), payloadSize);
+        if (!file)
+            return false;
+    }
+#ifdef _WIN32
+    // rename only replaces an existing file on POSIX
+    std::remove(path.c_str());
+#endif
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+#endif // CACHE_FILE_H
@@ -61,6 +61,13 @@ void Camera::ProcessMouseScroll(float yoffset) {
         Zoom = 45.0f;
 }
 
+void Camera::LookAlong(const glm::vec3& direction) {
+    glm::vec3 front = glm::normalize(direction);
+    Yaw = glm::degrees(atan2(front.z, front.x));
+    Pitch = glm::degrees(asin(front.y));
+    updateCameraVectors();
+}
+
 void Camera::updateCameraVectors() {
     // Calculate the new Front vector
     glm::vec3 front;
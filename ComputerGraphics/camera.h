@@ -57,6 +57,9 @@ public:
     // Processes input received from a mouse scroll-wheel event
     void ProcessMouseScroll(float yoffset);
 
+    // Points the camera along a direction (sets Yaw and Pitch)
+    void LookAlong(const glm::vec3& direction);
+
 private:
     // Calculates the front vector from the Camera's (updated) Euler Angles
     void updateCameraVectors();
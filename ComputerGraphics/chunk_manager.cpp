@@ -0,0 +1,489 @@
+#include "chunk_manager.h"
+#include "perlin.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+ChunkManager::ChunkManager(int chunkSize, float scale, int lodLevels, int maxChunks, unsigned int seed)
+    : chunkSize(chunkSize),
+    scale(scale),
+    lodLevels(lodLevels),
+    maxChunks(maxChunks),
+    noise(seed),
+    heightMin(-Terrain::heightBound()),
+    heightMax(Terrain::heightBound()) {
+    // Leave one core for the render loop
+    int workerThreads = std::max(1, workerCount() - 1);
+    for (int i = 0; i < workerThreads; ++i)
+        workers.emplace_back(&ChunkManager::workerLoop, this);
+}
+
+ChunkManager::~ChunkManager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& t : workers)
+        t.join();
+}
+
+float ChunkManager::nodeDistance(const NodeKey& k, const glm::vec3& cameraPos) const {
+    // Horizontal distance from the camera to the node's square; the vertex
+    // shader measures morph distance the same way so both agree on LOD
+    float size = nodeSize(k.level);
+    float minX = k.x * size, minZ = k.z * size;
+    float dx = std::max(std::max(minX - cameraPos.x, cameraPos.x - (minX + size)), 0.0f);
+    float dz = std::max(std::max(minZ - cameraPos.z, cameraPos.z - (minZ + size)), 0.0f);
+    return std::sqrt(dx * dx + dz * dz);
+}
+
+void ChunkManager::enableTileCache(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!tileCache)
+        tileCache.reset(new TileCache(noise.seed(), directory));
+}
+
+void ChunkManager::workerLoop() {
+    // Chunks are small; generate each one on this thread alone
+    isWorkerThread() = true;
+
+    while (true) {
+        NodeKey k;
+        TileCache* cache;
+        std::shared_ptr<const BakedChunk> bakedChunk;
+        std::vector<TerrainBrush> replay;
+        size_t editsApplied;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this] { return stopping || !requests.empty(); });
+            if (stopping)
+                return;
+            k = requests.front();
+            requests.pop_front();
+            cache = tileCache.get();
+            auto b = baked.find(k);
+            if (b != baked.end())
+                bakedChunk = b->second;
+            collectEdits(k, bakedChunk ? bakedChunk->editsApplied : 0, replay);
+            editsApplied = editCount;
+        }
+
+        std::unique_ptr<Terrain> terrain = baseTerrain(k, cache, bakedChunk.get());
+        bool edited = bakedChunk != nullptr;
+        for (const TerrainBrush& brush : replay)
+            edited |= terrain->edit(brush);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back({ k, std::move(terrain), editsApplied, edited });
+    }
+}
+
+std::unique_ptr<Terrain> ChunkManager::baseTerrain(const NodeKey& k, TileCache* cache,
+    const BakedChunk* bakedChunk) const {
+    // Same quad count at every level, with quads 2^level times wider
+    float levelScale = scale * static_cast<float>(1 << k.level);
+    int originX = k.x * chunkSize, originZ = k.z * chunkSize;
+    std::unique_ptr<Terrain> terrain;
+    if (bakedChunk) {
+        terrain.reset(new Terrain(chunkSize, chunkSize, levelScale, originX, originZ,
+            bakedChunk->heights.data(), bakedChunk->normals.data()));
+        return terrain;
+    }
+    if (cache)
+        terrain = cache->load(chunkSize, chunkSize, levelScale, originX, originZ);
+    if (!terrain) {
+        terrain.reset(new Terrain(chunkSize, chunkSize, levelScale, originX, originZ, noise));
+        if (cache)
+            cache->store(*terrain);
+    }
+    return terrain;
+}
+
+void ChunkManager::update(const glm::vec3& cameraPos, const glm::mat4& viewProjection) {
+    ++frame;
+    Frustum frustum(viewProjection);
+    tested = 0;
+    culled = 0;
+
+    std::vector<FinishedChunk> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Take finished chunks, leaving any over this frame's upload budget for later
+        int take = std::min(uploadsPerFrame, static_cast<int>(finished.size()));
+        for (int i = 0; i < take; ++i)
+            ready.push_back(std::move(finished[i]));
+        finished.erase(finished.begin(), finished.begin() + take);
+
+        // Requests nobody has picked up yet are rebuilt from scratch below, so
+        // nodes the camera no longer needs never get generated
+        for (const NodeKey& k : requests)
+            pending.erase(k);
+        requests.clear();
+    }
+
+    // Upload on the GL thread
+    std::vector<TerrainBrush> catchUp;
+    for (FinishedChunk& entry : ready) {
+        // Catch up on edits made while the chunk was being generated; if it
+        // was baked meanwhile, some of them may be gone, so start from that
+        auto b = baked.find(entry.key);
+        if (b != baked.end() && b->second->editsApplied > entry.editsApplied) {
+            entry.terrain = baseTerrain(entry.key, nullptr, b->second.get());
+            entry.editsApplied = b->second->editsApplied;
+            entry.edited = true;
+        }
+        catchUp.clear();
+        collectEdits(entry.key, entry.editsApplied, catchUp);
+        for (const TerrainBrush& brush : catchUp)
+            entry.edited |= entry.terrain->edit(brush);
+        heightMin = std::min(heightMin, entry.terrain->getBoundsMin().y);
+        heightMax = std::max(heightMax, entry.terrain->getBoundsMax().y);
+
+        Chunk& chunk = chunks[entry.key];
+        chunk.terrain = std::move(entry.terrain);
+        chunk.level = entry.key.level;
+        chunk.edited = entry.edited;
+        chunk.lastUsed = frame;
+        uploadChunk(chunk);
+        pending.erase(entry.key);
+    }
+
+    // Walk the quadtree from every top-level node in range
+    visible.clear();
+    missing.clear();
+    int top = lodLevels - 1;
+    float topSize = nodeSize(top);
+    float range = lodRange(top);
+    int x0 = static_cast<int>(std::floor((cameraPos.x - range) / topSize));
+    int x1 = static_cast<int>(std::floor((cameraPos.x + range) / topSize));
+    int z0 = static_cast<int>(std::floor((cameraPos.z - range) / topSize));
+    int z1 = static_cast<int>(std::floor((cameraPos.z + range) / topSize));
+    for (int z = z0; z <= z1; ++z) {
+        for (int x = x0; x <= x1; ++x) {
+            NodeKey root = { top, x, z };
+            if (nodeDistance(root, cameraPos) < range)
+                selectNode(root, cameraPos, frustum, INTERSECTING);
+        }
+    }
+
+    // Queue the missing nodes, nearest first
+    if (!missing.empty()) {
+        std::sort(missing.begin(), missing.end(),
+            [](const std::pair<float, NodeKey>& a, const std::pair<float, NodeKey>& b) { return a.first < b.first; });
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& m : missing)
+                requests.push_back(m.second);
+        }
+        workAvailable.notify_all();
+    }
+
+    evict();
+}
+
+void ChunkManager::selectNode(const NodeKey& k, const glm::vec3& cameraPos, const Frustum& frustum, Frustum_Test parentTest) {
+    float distance = nodeDistance(k, cameraPos);
+    auto self = chunks.find(k);
+    if (self != chunks.end())
+        self->second.lastUsed = frame;
+
+    if (k.level > 0 && distance < lodRange(k.level - 1)) {
+        // Descendants may poke above or below this node's own samples, so the
+        // subtree is tested with the height range of all terrain so far
+        Frustum_Test test = parentTest;
+        if (test == INTERSECTING) {
+            float size = nodeSize(k.level);
+            test = cullNode(frustum, glm::vec3(k.x * size, heightMin * TERRAIN_HEIGHT_SCALE, k.z * size),
+                glm::vec3((k.x + 1) * size, heightMax * TERRAIN_HEIGHT_SCALE, (k.z + 1) * size));
+        }
+
+        NodeKey children[4] = {
+            { k.level - 1, 2 * k.x, 2 * k.z }, { k.level - 1, 2 * k.x + 1, 2 * k.z },
+            { k.level - 1, 2 * k.x, 2 * k.z + 1 }, { k.level - 1, 2 * k.x + 1, 2 * k.z + 1 }
+        };
+        bool childrenReady = true;
+        for (const NodeKey& child : children) {
+            auto it = chunks.find(child);
+            if (it == chunks.end()) {
+                childrenReady = false;
+                request(child, nodeDistance(child, cameraPos));
+            }
+            else {
+                it->second.lastUsed = frame;
+            }
+        }
+
+        // Keep drawing this node until all of its children have streamed in
+        if (childrenReady || self == chunks.end()) {
+            for (const NodeKey& child : children)
+                selectNode(child, cameraPos, frustum, test);
+            return;
+        }
+        parentTest = test;
+    }
+
+    if (self == chunks.end()) {
+        request(k, distance);
+        return;
+    }
+
+    // Nodes out of view stay resident (the camera may turn back) but aren't drawn
+    Frustum_Test test = parentTest;
+    if (test == INTERSECTING) {
+        const Terrain& terrain = *self->second.terrain;
+        glm::vec3 scaleY(1.0f, TERRAIN_HEIGHT_SCALE, 1.0f);
+        test = cullNode(frustum, terrain.getBoundsMin() * scaleY, terrain.getBoundsMax() * scaleY);
+    }
+    if (test != OUTSIDE)
+        visible.push_back(&self->second);
+}
+
+Frustum_Test ChunkManager::cullNode(const Frustum& frustum, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    ++tested;
+    Frustum_Test test = frustum.testAABB(boxMin, boxMax);
+    if (test == OUTSIDE)
+        ++culled;
+    return test;
+}
+
+void ChunkManager::request(const NodeKey& k, float distance) {
+    if (pending.insert(k).second)
+        missing.emplace_back(distance, k);
+}
+
+void ChunkManager::evict() {
+    if (static_cast<int>(chunks.size()) <= maxChunks)
+        return;
+
+    // Only chunks the current selection did not touch are candidates, oldest first
+    std::vector<std::pair<unsigned long, NodeKey>> candidates;
+    for (const auto& entry : chunks) {
+        if (entry.second.lastUsed != frame)
+            candidates.emplace_back(entry.second.lastUsed, entry.first);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [](const std::pair<unsigned long, NodeKey>& a, const std::pair<unsigned long, NodeKey>& b) { return a.first < b.first; });
+
+    for (const auto& c : candidates) {
+        if (static_cast<int>(chunks.size()) <= maxChunks)
+            break;
+        auto it = chunks.find(c.second);
+        if (it->second.edited)
+            bake(it->first, *it->second.terrain);
+        if (it->second.heightmapLayer >= 0)
+            heightmaps->removeLayer(it->second.heightmapLayer);
+        chunks.erase(it); // Terrain's destructor frees its GL buffers
+    }
+}
+
+void ChunkManager::uploadChunk(Chunk& chunk) {
+    int editedBegin = chunk.terrain->dirtyRowsBegin(), editedEnd = chunk.terrain->dirtyRowsEnd();
+    chunk.terrain->upload(vertexFormat);
+    if (vertexFormat == TERRAIN_VERTEX_HEIGHTMAP) {
+        if (!heightmaps)
+            heightmaps.reset(new HeightmapRenderer(chunkSize));
+        if (chunk.heightmapLayer < 0)
+            chunk.heightmapLayer = heightmaps->addLayer(*chunk.terrain);
+        else if (editedBegin < editedEnd)
+            heightmaps->updateLayer(chunk.heightmapLayer, *chunk.terrain, editedBegin, editedEnd);
+    }
+    else if (chunk.heightmapLayer >= 0) {
+        heightmaps->removeLayer(chunk.heightmapLayer);
+        chunk.heightmapLayer = -1;
+    }
+}
+
+const Terrain* ChunkManager::finestChunk(int x, int z) const {
+    for (int level = 0; level < lodLevels; ++level) {
+        // Floor division, as node coordinates go negative
+        NodeKey k = { level, x >> level, z >> level };
+        auto it = chunks.find(k);
+        if (it != chunks.end())
+            return it->second.terrain.get();
+    }
+    return nullptr;
+}
+
+bool ChunkManager::heightAt(float x, float z, float& height) const {
+    float size = nodeSize(0);
+    const Terrain* terrain = finestChunk(static_cast<int>(std::floor(x / size)), static_cast<int>(std::floor(z / size)));
+    return terrain && terrain->heightAt(x, z, height);
+}
+
+bool ChunkManager::detailHeightAt(float x, float z, float& height) const {
+    float size = nodeSize(0);
+    NodeKey k = { 0, static_cast<int>(std::floor(x / size)), static_cast<int>(std::floor(z / size)) };
+    auto it = chunks.find(k);
+    return it != chunks.end() && it->second.terrain->heightAt(x, z, height);
+}
+
+bool ChunkManager::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, glm::vec3& hit) const {
+    // Walk the level 0 node grid along the ray (Amanatides & Woo), casting the
+    // stretch of the ray over each node against that node's finest chunk
+    float size = nodeSize(0);
+    int x = static_cast<int>(std::floor(origin.x / size));
+    int z = static_cast<int>(std::floor(origin.z / size));
+    int stepX = direction.x < 0.0f ? -1 : 1, stepZ = direction.z < 0.0f ? -1 : 1;
+    float nextX = direction.x != 0.0f ? ((x + (stepX > 0)) * size - origin.x) / direction.x : FLT_MAX;
+    float nextZ = direction.z != 0.0f ? ((z + (stepZ > 0)) * size - origin.z) / direction.z : FLT_MAX;
+    float deltaX = direction.x != 0.0f ? size / std::abs(direction.x) : FLT_MAX;
+    float deltaZ = direction.z != 0.0f ? size / std::abs(direction.z) : FLT_MAX;
+
+    float tEnter = 0.0f;
+    while (true) {
+        float tExit = std::min(std::min(nextX, nextZ), maxDistance);
+        const Terrain* terrain = finestChunk(x, z);
+        float t;
+        if (terrain && terrain->raycast(origin + tEnter * direction, direction, tExit - tEnter, t)) {
+            hit = origin + (tEnter + t) * direction;
+            return true;
+        }
+
+        if (tExit >= maxDistance)
+            return false;
+        tEnter = tExit;
+        if (nextX < nextZ) {
+            x += stepX;
+            nextX += deltaX;
+        }
+        else {
+            z += stepZ;
+            nextZ += deltaZ;
+        }
+    }
+}
+
+void ChunkManager::collectEdits(const NodeKey& k, size_t since, std::vector<TerrainBrush>& brushes) const {
+    // The level 0 nodes under k; a brush reaching several of them is in each
+    // of their lists, so gather by number and drop the repeats
+    int span = 1 << k.level;
+    int x0 = k.x * span, z0 = k.z * span;
+    std::vector<const Edit*> found;
+    auto gather = [&](const std::vector<Edit>& list) {
+        for (const Edit& e : list) {
+            if (e.number >= since)
+                found.push_back(&e);
+        }
+    };
+    if (static_cast<size_t>(span) * span <= edits.size()) {
+        for (int z = z0; z < z0 + span; ++z) {
+            for (int x = x0; x < x0 + span; ++x) {
+                auto it = edits.find({ 0, x, z });
+                if (it != edits.end())
+                    gather(it->second);
+            }
+        }
+    }
+    else {
+        // Coarse node, few edited places: cheaper to scan them all
+        for (const auto& entry : edits) {
+            const NodeKey& e = entry.first;
+            if (e.x >= x0 && e.x < x0 + span && e.z >= z0 && e.z < z0 + span)
+                gather(entry.second);
+        }
+    }
+
+    std::sort(found.begin(), found.end(), [](const Edit* a, const Edit* b) { return a->number < b->number; });
+    found.erase(std::unique(found.begin(), found.end(),
+        [](const Edit* a, const Edit* b) { return a->number == b->number; }), found.end());
+    for (const Edit* e : found)
+        brushes.push_back(e->brush);
+}
+
+void ChunkManager::edit(const TerrainBrush& brush) {
+    if (brush.radius <= 0.0f)
+        return;
+
+    // File the brush under every level 0 node its bounding square reaches
+    float size = nodeSize(0);
+    int x0 = static_cast<int>(std::floor((brush.x - brush.radius) / size));
+    int x1 = static_cast<int>(std::floor((brush.x + brush.radius) / size));
+    int z0 = static_cast<int>(std::floor((brush.z - brush.radius) / size));
+    int z1 = static_cast<int>(std::floor((brush.z + brush.radius) / size));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Edit e = { editCount++, brush };
+        for (int z = z0; z <= z1; ++z) {
+            for (int x = x0; x <= x1; ++x)
+                edits[{ 0, x, z }].push_back(e);
+        }
+    }
+
+    for (auto& entry : chunks) {
+        Terrain& terrain = *entry.second.terrain;
+        if (terrain.edit(brush)) {
+            entry.second.edited = true;
+            heightMin = std::min(heightMin, terrain.getBoundsMin().y);
+            heightMax = std::max(heightMax, terrain.getBoundsMax().y);
+            uploadChunk(entry.second);
+        }
+    }
+
+    // Resident chunks have the brush now; keep the lists it went into short
+    for (int z = z0; z <= z1; ++z) {
+        for (int x = x0; x <= x1; ++x) {
+            auto it = edits.find({ 0, x, z });
+            if (it != edits.end() && it->second.size() >= MaxNodeEdits)
+                compactEdits(x, z);
+        }
+    }
+}
+
+void ChunkManager::bake(const NodeKey& k, const Terrain& terrain) {
+    std::shared_ptr<BakedChunk> b(new BakedChunk());
+    b->editsApplied = editCount;
+    b->heights = terrain.getHeights();
+    b->normals = terrain.getNormalsXZ();
+    std::lock_guard<std::mutex> lock(mutex);
+    baked[k] = std::move(b);
+}
+
+void ChunkManager::compactEdits(int x, int z) {
+    // Resident chunks have every edit already; bring the chunk over this node
+    // at every other level up to date too, so none of them needs the list
+    std::vector<TerrainBrush> replay;
+    for (int level = 0; level < lodLevels; ++level) {
+        NodeKey k = { level, x >> level, z >> level };
+        if (chunks.count(k))
+            continue;
+        auto b = baked.find(k);
+        const BakedChunk* bakedChunk = b != baked.end() ? b->second.get() : nullptr;
+        std::unique_ptr<Terrain> terrain = baseTerrain(k, tileCache.get(), bakedChunk);
+        replay.clear();
+        collectEdits(k, bakedChunk ? bakedChunk->editsApplied : 0, replay);
+        for (const TerrainBrush& brush : replay)
+            terrain->edit(brush);
+        bake(k, *terrain);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    edits.erase({ 0, x, z });
+}
+
+void ChunkManager::setVertexFormat(Terrain_Vertex_Format format) {
+    vertexFormat = format;
+    for (auto& entry : chunks)
+        uploadChunk(entry.second);
+}
+
+void ChunkManager::Draw(Shader& shader) {
+    if (vertexFormat == TERRAIN_VERTEX_HEIGHTMAP) {
+        if (!heightmaps)
+            return;
+        instances.clear();
+        for (Chunk* chunk : visible) {
+            instances.push_back(heightmaps->makeInstance(*chunk->terrain, chunk->heightmapLayer,
+                morphStart(chunk->level), lodRange(chunk->level)));
+        }
+        heightmaps->Draw(shader, instances);
+        return;
+    }
+
+    for (Chunk* chunk : visible) {
+        shader.setVec2("morphRange", morphStart(chunk->level), lodRange(chunk->level));
+        chunk->terrain->Draw(shader);
+    }
+}
@@ -0,0 +1,217 @@
+#ifndef CHUNK_MANAGER_H
+#define CHUNK_MANAGER_H
+
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "terrain.h"
+#include "frustum.h"
+#include "heightmap_renderer.h"
+#include "noise_context.h"
+#include "tile_cache.h"
+
+// Streams an endless terrain as a CDLOD quadtree of Terrain chunks around the
+// camera. Every node has the same chunkSize x chunkSize quads; a node at level L
+// covers 2^L times the width of a level 0 node, so the triangle count per frame
+// only grows with the number of levels, not with the view distance. Vertices
+// morph toward the next coarser grid near the end of their level's range, which
+// hides LOD switches and keeps neighbouring levels crack-free.
+//
+// Selected nodes are frustum culled hierarchically: a quadtree node that lies
+// entirely outside (or inside) the view frustum settles the test for all of its
+// descendants. Drawn nodes are tested against the AABB of their actual heights.
+//
+// Chunks are generated on worker threads, uploaded on the GL thread a few at a
+// time from update(), and evicted least-recently-used once more than maxChunks
+// are resident.
+class ChunkManager {
+public:
+    // chunkSize: quads per node side, scale: world units per quad at level 0,
+    // lodLevels: number of quadtree levels, maxChunks: resident chunk budget,
+    // seed: noise seed (random unless given, e.g. for reproducible benchmarks)
+    ChunkManager(int chunkSize, float scale, int lodLevels, int maxChunks,
+        unsigned int seed = std::random_device()());
+    ~ChunkManager();
+
+    ChunkManager(const ChunkManager&) = delete;
+    ChunkManager& operator=(const ChunkManager&) = delete;
+
+    // Same seed, same landscape, on any run or platform
+    unsigned int seed() const { return noise.seed(); }
+    int getChunkSize() const { return chunkSize; }
+
+    // Reads chunks generated on earlier runs from, and saves new ones to, an
+    // on-disk TileCache in directory. Off until called; can't be turned off.
+    void enableTileCache(const std::string& directory = TERRAIN_CACHE_DIRECTORY);
+    const TileCache* getTileCache() const { return tileCache.get(); }
+
+    // Selects the LOD nodes around the camera, keeps the ones inside the
+    // frustum of viewProjection for drawing, queues missing ones, uploads
+    // finished ones and evicts chunks over budget. Never waits on generation
+    // (GL thread only).
+    void update(const glm::vec3& cameraPos, const glm::mat4& viewProjection);
+
+    // Draws the visible nodes selected by the last update()
+    void Draw(Shader& shader);
+
+    // Height of the terrain at world (x, z) (see Terrain::heightAt), from the
+    // finest resident chunk there; false if no chunk covers it yet
+    bool heightAt(float x, float z, float& height) const;
+    // Height at world (x, z) from a level 0 chunk only, i.e. at full
+    // resolution; false while only coarser chunks (or none) cover it
+    bool detailHeightAt(float x, float z, float& height) const;
+    // Nearest point within maxDistance (in multiples of direction) where a
+    // world-space ray meets the resident terrain, each place tested against
+    // its finest resident chunk; false if it misses
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, glm::vec3& hit) const;
+
+    // Applies a brush to every resident chunk it covers, at every LOD level,
+    // and re-uploads only their changed rows. Edits are replayed on chunks
+    // generated later, and an edited chunk keeps its heights in memory when it
+    // is evicted, so they survive eviction; the tile cache keeps the unedited
+    // terrain. Once a place has had MaxNodeEdits brushes they are baked into
+    // every chunk over it and forgotten, so rebuilding a chunk never replays
+    // more than that (GL thread only).
+    void edit(const TerrainBrush& brush);
+
+    // Vertex buffer layout for chunks; switching re-uploads every resident
+    // chunk, so both layouts can be compared in one run
+    void setVertexFormat(Terrain_Vertex_Format format);
+    Terrain_Vertex_Format getVertexFormat() const { return vertexFormat; }
+
+    // Distance from the camera at which terrain ends
+    float viewDistance() const { return lodRange(lodLevels - 1); }
+
+    int residentChunks() const { return static_cast<int>(chunks.size()); }
+    int pendingChunks() const { return static_cast<int>(pending.size()); }
+    int visibleChunks() const { return static_cast<int>(visible.size()); }
+
+    // Frustum culling counters for the last update(): bounding boxes tested,
+    // nodes rejected (a rejected quadtree node counts once for its subtree)
+    // and chunks drawn
+    int chunksTested() const { return tested; }
+    int chunksCulled() const { return culled; }
+    int chunksDrawn() const { return static_cast<int>(visible.size()); }
+
+private:
+    struct NodeKey {
+        int level, x, z;
+        bool operator==(const NodeKey& o) const { return level == o.level && x == o.x && z == o.z; }
+    };
+
+    struct NodeKeyHash {
+        std::size_t operator()(const NodeKey& k) const {
+            return (static_cast<std::size_t>(k.x) * 73856093u) ^ (static_cast<std::size_t>(k.z) * 19349663u)
+                ^ (static_cast<std::size_t>(k.level) * 83492791u);
+        }
+    };
+
+    struct FinishedChunk {
+        NodeKey key;
+        std::unique_ptr<Terrain> terrain;
+        size_t editsApplied; // edits numbered below this were replayed by the worker
+        bool edited;         // an edit changed it
+    };
+
+    // A brush and its place in the order edits were made
+    struct Edit {
+        size_t number;
+        TerrainBrush brush;
+    };
+
+    // Heights and normals of a chunk with the edits numbered below
+    // editsApplied in them, kept once it is evicted (or baked to trim the
+    // edit lists) so it is never rebuilt from the edit history
+    struct BakedChunk {
+        size_t editsApplied;
+        std::vector<float> heights, normals;
+    };
+
+    struct Chunk {
+        std::unique_ptr<Terrain> terrain;
+        int level = 0;
+        bool edited = false; // differs from the generated terrain
+        int heightmapLayer = -1; // Layer in heightmaps when drawing TERRAIN_VERTEX_HEIGHTMAP
+        unsigned long lastUsed = 0;
+    };
+
+    int chunkSize;
+    float scale;
+    int lodLevels;
+    int maxChunks;
+    int uploadsPerFrame = 4;
+    Terrain_Vertex_Format vertexFormat = TERRAIN_VERTEX_COMPACT;
+    unsigned long frame = 0;
+    NoiseContext noise;
+
+    // GL thread state
+    std::unique_ptr<HeightmapRenderer> heightmaps; // Created on first use of TERRAIN_VERTEX_HEIGHTMAP
+    std::vector<HeightmapRenderer::Instance> instances;
+    std::unordered_map<NodeKey, Chunk, NodeKeyHash> chunks;
+    std::unordered_set<NodeKey, NodeKeyHash> pending; // queued or being generated
+    std::vector<Chunk*> visible;
+    std::vector<std::pair<float, NodeKey>> missing;
+    int tested = 0;
+    int culled = 0;
+    // Lowest and highest height (before TERRAIN_HEIGHT_SCALE) of any chunk
+    // uploaded or edited so far; widened as edits push terrain past the
+    // generated heightBound()
+    float heightMin, heightMax;
+
+    // Shared with the workers
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::deque<NodeKey> requests;          // nearest node first
+    std::vector<FinishedChunk> finished;
+    // Edits by the level 0 node they reach, so a chunk replays only its own,
+    // and the edited chunks baked so far; changed only by the GL thread
+    std::unordered_map<NodeKey, std::vector<Edit>, NodeKeyHash> edits;
+    std::unordered_map<NodeKey, std::shared_ptr<const BakedChunk>, NodeKeyHash> baked;
+    size_t editCount = 0;
+    std::unique_ptr<TileCache> tileCache;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    float nodeSize(int level) const { return chunkSize * scale * static_cast<float>(1 << level); }
+    // A node is split into its children while the camera is closer than the
+    // children's range; ranges double per level. Any factor above 2*sqrt(2)
+    // node sizes keeps neighbouring nodes within one level of each other and
+    // leaves the coarser side unmorphed where they meet; 5 leaves room for a
+    // wide morph band.
+    float lodRange(int level) const { return 5.0f * nodeSize(level); }
+    float morphStart(int level) const { return 0.8f * lodRange(level); }
+    float nodeDistance(const NodeKey& k, const glm::vec3& cameraPos) const;
+    // Finest resident chunk over level 0 node (x, z), or null
+    const Terrain* finestChunk(int x, int z) const;
+
+    // A level 0 node's edits are baked into every chunk over it, and dropped,
+    // once it has this many
+    static const size_t MaxNodeEdits = 64;
+
+    void workerLoop();
+    // Node k's terrain from its baked copy if it has one, else from the tile
+    // cache or the noise
+    std::unique_ptr<Terrain> baseTerrain(const NodeKey& k, TileCache* cache, const BakedChunk* bakedChunk) const;
+    void bake(const NodeKey& k, const Terrain& terrain);
+    // Bakes every chunk over level 0 node (x, z) that isn't resident and drops its edits
+    void compactEdits(int x, int z);
+    // Appends the edits numbered since or later that reach node k to brushes,
+    // in the order they were made (mutex held, or on the GL thread)
+    void collectEdits(const NodeKey& k, size_t since, std::vector<TerrainBrush>& brushes) const;
+    void selectNode(const NodeKey& k, const glm::vec3& cameraPos, const Frustum& frustum, Frustum_Test parentTest);
+    Frustum_Test cullNode(const Frustum& frustum, const glm::vec3& boxMin, const glm::vec3& boxMax);
+    void request(const NodeKey& k, float distance);
+    void evict();
+    void uploadChunk(Chunk& chunk);
+};
+
+#endif // CHUNK_MANAGER_H
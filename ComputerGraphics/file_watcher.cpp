@@ -0,0 +1,119 @@
+#include "file_watcher.h"
+#include <algorithm>
+#ifdef __linux__
+#include <climits>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <chrono>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#ifdef __linux__
+
+namespace {
+
+// Splits a path into its directory ("." if none) and file name
+void splitPath(const std::string& path, std::string& directory, std::string& name) {
+    size_t slash = path.find_last_of("/");
+    directory = slash == std::string::npos ? "." : path.substr(0, slash);
+    name = slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
+FileWatcher::FileWatcher() {
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+FileWatcher::~FileWatcher() {
+    if (fd >= 0)
+        close(fd);
+}
+
+void FileWatcher::watch(const std::string& path) {
+    if (fd < 0)
+        return;
+    std::string directory, name;
+    splitPath(path, directory, name);
+
+    // Watching a directory twice returns the same descriptor
+    int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0)
+        return;
+    directories[wd] = directory;
+    files[directory + "/" + name] = path;
+}
+
+std::vector<std::string> FileWatcher::changes() {
+    std::vector<std::string> changed;
+    if (fd < 0)
+        return changed;
+
+    alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+    while (true) {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break; // EAGAIN: nothing more queued
+
+        for (ssize_t offset = 0; offset < length; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            auto directory = directories.find(event->wd);
+            if (directory == directories.end() || event->len == 0)
+                continue;
+            auto file = files.find(directory->second + "/" + event->name);
+            if (file != files.end() && std::find(changed.begin(), changed.end(), file->second) == changed.end())
+                changed.push_back(file->second);
+        }
+    }
+    return changed;
+}
+
+#else
+
+namespace {
+
+long long modificationTime(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? static_cast<long long>(info.st_mtime) : -1;
+}
+
+double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+FileWatcher::FileWatcher() {
+}
+
+FileWatcher::~FileWatcher() {
+}
+
+void FileWatcher::watch(const std::string& path) {
+    modified[path] = modificationTime(path);
+}
+
+std::vector<std::string> FileWatcher::changes() {
+    std::vector<std::string> changed;
+    double time = now();
+    if (time - lastPoll < PollInterval)
+        return changed;
+    lastPoll = time;
+
+    for (auto& file : modified) {
+        long long mtime = modificationTime(file.first);
+        // A missing file is usually mid-save; wait for it to reappear
+        if (mtime >= 0 && mtime != file.second) {
+            file.second = mtime;
+            changed.push_back(file.first);
+        }
+    }
+    return changed;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports which of a set of files have been written since the last check.
+// On Linux this uses inotify on each file's directory (so editors that save
+// by writing a new file and renaming it over the old one are caught too);
+// elsewhere it compares modification times, at most every PollInterval
+// seconds. changes() never blocks, so it can be called every frame.
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    void watch(const std::string& path);
+
+    // Watched paths (as passed to watch()) written since the last call
+    std::vector<std::string> changes();
+
+private:
+#ifdef __linux__
+    int fd = -1;
+    // Watch descriptor -> directory, and "directory/name" -> watched path
+    std::unordered_map<int, std::string> directories;
+    std::unordered_map<std::string, std::string> files;
+#else
+    static constexpr double PollInterval = 0.25;
+
+    // Watched path -> last seen modification time
+    std::unordered_map<std::string, long long> modified;
+    double lastPoll = 0.0;
+#endif
+};
+
+#endif // FILE_WATCHER_H
@@ -0,0 +1,27 @@
+#include "frame_uniforms.h"
+#include "gl_buffer.h"
+
+FrameUniforms::FrameUniforms() {
+    glGenBuffers(1, &UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Data), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, UBO);
+}
+
+FrameUniforms::~FrameUniforms() {
+    glDeleteBuffers(1, &UBO);
+}
+
+void FrameUniforms::update(const glm::mat4& view, const glm::mat4& projection,
+    const glm::vec3& lightPos, float lightIntensity, const glm::vec3& viewPos) {
+    Data data;
+    data.view = view;
+    data.projection = projection;
+    data.lightPos = lightPos;
+    data.lightIntensity = lightIntensity;
+    data.viewPos = viewPos;
+    data.padding = 0.0f;
+
+    orphanAndUpload(GL_UNIFORM_BUFFER, UBO, sizeof(Data), &data);
+}
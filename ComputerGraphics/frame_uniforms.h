@@ -0,0 +1,46 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Uniform block holding the values every program needs once per frame. Any
+// shader that declares it gets it bound to FRAME_UNIFORMS_BINDING when it is
+// linked (see Shader), so one buffer update per frame reaches all of them:
+//
+//     layout (std140) uniform FrameUniforms {
+//         mat4 view;
+//         mat4 projection;
+//         vec3 lightPos;
+//         float lightIntensity;
+//         vec3 viewPos;
+//     };
+const char* const FRAME_UNIFORMS_BLOCK = "FrameUniforms";
+const unsigned int FRAME_UNIFORMS_BINDING = 0;
+
+class FrameUniforms {
+public:
+    FrameUniforms();
+    ~FrameUniforms();
+
+    FrameUniforms(const FrameUniforms&) = delete;
+    FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+    void update(const glm::mat4& view, const glm::mat4& projection,
+        const glm::vec3& lightPos, float lightIntensity, const glm::vec3& viewPos);
+
+private:
+    // std140 layout of the block: a vec3 followed by a float shares one 16-byte slot
+    struct Data {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec3 lightPos;
+        float lightIntensity;
+        glm::vec3 viewPos;
+        float padding;
+    };
+
+    unsigned int UBO = 0;
+};
+
+#endif // FRAME_UNIFORMS_H
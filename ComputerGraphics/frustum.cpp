@@ -0,0 +1,41 @@
+#include "frustum.h"
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    // glm is column-major: m[col][row], so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    const glm::mat4& m = viewProjection;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    planes[0] = row3 + row0; // Left
+    planes[1] = row3 - row0; // Right
+    planes[2] = row3 + row1; // Bottom
+    planes[3] = row3 - row1; // Top
+    planes[4] = row3 + row2; // Near
+    planes[5] = row3 - row2; // Far
+
+    for (glm::vec4& plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+Frustum_Test Frustum::testAABB(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+    Frustum_Test result = INSIDE;
+    for (const glm::vec4& plane : planes) {
+        glm::vec3 normal(plane);
+
+        // Corner furthest along the plane normal, and the one furthest against it
+        glm::vec3 positive(normal.x >= 0 ? boxMax.x : boxMin.x,
+            normal.y >= 0 ? boxMax.y : boxMin.y,
+            normal.z >= 0 ? boxMax.z : boxMin.z);
+        glm::vec3 negative(normal.x >= 0 ? boxMin.x : boxMax.x,
+            normal.y >= 0 ? boxMin.y : boxMax.y,
+            normal.z >= 0 ? boxMin.z : boxMax.z);
+
+        if (glm::dot(normal, positive) + plane.w < 0)
+            return OUTSIDE;
+        if (glm::dot(normal, negative) + plane.w < 0)
+            result = INTERSECTING;
+    }
+    return result;
+}
@@ -0,0 +1,26 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// Result of testing a bounding volume against the frustum
+enum Frustum_Test {
+    OUTSIDE,
+    INTERSECTING,
+    INSIDE
+};
+
+class Frustum {
+public:
+    // Extracts the six clip planes from a projection * view matrix
+    // (Gribb/Hartmann); planes point inward and are normalized
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    // Classifies an axis-aligned box given by its min and max corners
+    Frustum_Test testAABB(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+private:
+    glm::vec4 planes[6];
+};
+
+#endif // FRUSTUM_H
@@ -0,0 +1,19 @@
+#ifndef GL_BUFFER_H
+#define GL_BUFFER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+
+// Replaces the contents of a buffer that is rewritten every frame with size
+// bytes from data. The old storage is orphaned first (glBufferData without
+// data), so the driver hands out fresh memory while the GPU may still be
+// drawing from last frame's, instead of stalling until it is done. Leaves
+// nothing bound to target.
+inline void orphanAndUpload(GLenum target, unsigned int buffer, std::size_t size, const void* data) {
+    glBindBuffer(target, buffer);
+    glBufferData(target, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(target, 0, static_cast<GLsizeiptr>(size), data);
+    glBindBuffer(target, 0);
+}
+
+#endif // GL_BUFFER_H
@@ -0,0 +1,76 @@
+#include "gpu_timer.h"
+#include <utility>
+
+GpuTimer::GpuTimer(int phases)
+    : phaseCount(phases),
+    queries(Latency * (phases + 1) * 2),
+    queried(Latency * phases, false) {
+    glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+}
+
+GpuTimer::~GpuTimer() {
+    glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+}
+
+void GpuTimer::beginFrame() {
+    // Reuse the oldest queries once their results are in
+    if (issued - readCount == Latency)
+        readBack();
+    glQueryCounter(frameQueries(issued)[0], GL_TIMESTAMP);
+    int slot = issued % Latency;
+    for (int phase = 0; phase < phaseCount; ++phase)
+        queried[slot * phaseCount + phase] = false;
+}
+
+void GpuTimer::endFrame() {
+    glQueryCounter(frameQueries(issued)[1], GL_TIMESTAMP);
+    ++issued;
+}
+
+void GpuTimer::begin(int phase) {
+    glQueryCounter(frameQueries(issued)[2 + phase * 2], GL_TIMESTAMP);
+    queried[(issued % Latency) * phaseCount + phase] = true;
+}
+
+void GpuTimer::end(int phase) {
+    glQueryCounter(frameQueries(issued)[3 + phase * 2], GL_TIMESTAMP);
+}
+
+void GpuTimer::finish() {
+    while (readCount < issued)
+        readBack();
+}
+
+bool GpuTimer::takeFrame(Frame& frame) {
+    if (results.empty())
+        return false;
+    frame = std::move(results.front());
+    results.pop_front();
+    return true;
+}
+
+void GpuTimer::readBack() {
+    const unsigned int* timestamps = frameQueries(readCount);
+    int slot = readCount % Latency;
+    GLuint64 start = 0, end = 0;
+    Frame frame;
+    glGetQueryObjectui64v(timestamps[0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(timestamps[1], GL_QUERY_RESULT, &end);
+    frame.ms = (end - start) / 1.0e6;
+
+    frame.phases.resize(phaseCount);
+    for (int phase = 0; phase < phaseCount; ++phase) {
+        Span& span = frame.phases[phase];
+        span.timed = queried[slot * phaseCount + phase];
+        span.startMs = span.ms = 0.0;
+        if (!span.timed)
+            continue;
+        glGetQueryObjectui64v(timestamps[2 + phase * 2], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(timestamps[3 + phase * 2], GL_QUERY_RESULT, &end);
+        span.startMs = start / 1.0e6;
+        span.ms = (end - start) / 1.0e6;
+    }
+
+    results.push_back(std::move(frame));
+    ++readCount;
+}
@@ -0,0 +1,62 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+#include <deque>
+#include <vector>
+
+// Measures GPU time from pairs of GL_TIMESTAMP queries (GL_TIME_ELAPSED returns
+// garbage for the first query on llvmpipe, and cannot time back-to-back phases
+// without a query per phase anyway): the whole frame, and any number of phases
+// within it. A frame is only read back once its queries are several frames
+// old, so timing never stalls the CPU waiting for the GPU.
+class GpuTimer {
+public:
+    // A phase of one frame, in milliseconds on the GPU clock
+    struct Span {
+        bool timed;     // false if the phase did not run that frame
+        double startMs;
+        double ms;
+    };
+
+    struct Frame {
+        double ms; // from beginFrame() to endFrame()
+        std::vector<Span> phases;
+    };
+
+    // phases: number of phases timed with begin()/end(), numbered from 0
+    explicit GpuTimer(int phases = 0);
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void beginFrame();
+    // Call after the buffer swap, so deferred renderers such as llvmpipe have
+    // executed the frame by the time the end timestamp is written
+    void endFrame();
+    void begin(int phase);
+    void end(int phase);
+    // Waits for the frames still in flight
+    void finish();
+
+    // Moves the oldest frame read back into frame; false if none is waiting.
+    // Frames come out in the order they were timed.
+    bool takeFrame(Frame& frame);
+
+private:
+    static const int Latency = 4;
+    int phaseCount;
+    // Start and end timestamps of each frame in flight: the whole frame, then
+    // each phase
+    std::vector<unsigned int> queries;
+    std::vector<bool> queried; // per phase of each frame in flight
+    int issued = 0;
+    int readCount = 0;
+    std::deque<Frame> results;
+
+    unsigned int* frameQueries(int frame) { return &queries[(frame % Latency) * (phaseCount + 1) * 2]; }
+    void readBack();
+};
+
+#endif // GPU_TIMER_H
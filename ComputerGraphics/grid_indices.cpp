@@ -0,0 +1,254 @@
+#include "grid_indices.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+void buildList(int width, int depth, std::vector<unsigned int>& indices) {
+    indices.resize(width * depth * 6);
+    parallelFor(0, depth, [&](int zBegin, int zEnd) {
+        for (int z = zBegin; z < zEnd; ++z) {
+            for (int x = 0; x < width; ++x) {
+                unsigned int current = z * (width + 1) + x;
+                unsigned int next = current + width + 1;
+                unsigned int* quad = &indices[(z * width + x) * 6];
+
+                quad[0] = current;
+                quad[1] = next;
+                quad[2] = current + 1;
+
+                quad[3] = current + 1;
+                quad[4] = next;
+                quad[5] = next + 1;
+            }
+        }
+    });
+}
+
+// Strips alternate (x, z), (x, z + 1) along each row of a band: even triangles
+// are (current, next, current + 1) and odd ones, with the winding flip strips
+// apply, (current + 1, next, next + 1), the same two triangles as the list
+void buildStrips(int width, int depth, int band, unsigned int restart, std::vector<unsigned int>& indices) {
+    indices.clear();
+    for (int x0 = 0; x0 < width; x0 += band) {
+        int x1 = std::min(x0 + band, width);
+        for (int z = 0; z < depth; ++z) {
+            for (int x = x0; x <= x1; ++x) {
+                indices.push_back(z * (width + 1) + x);
+                indices.push_back((z + 1) * (width + 1) + x);
+            }
+            indices.push_back(restart);
+        }
+    }
+    indices.pop_back(); // No restart needed after the last strip
+}
+
+// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation" (2006): greedily emit
+// the triangle whose vertices score highest, where a vertex scores for sitting
+// near the front of a simulated LRU cache and for having few triangles left
+void optimizeForCache(std::vector<unsigned int>& indices, int vertexCount) {
+    const int CacheSize = 32;
+    int triangleCount = static_cast<int>(indices.size() / 3);
+
+    // Triangles using each vertex; the first remaining[v] entries are the ones not yet emitted
+    std::vector<int> offsets(vertexCount + 1, 0), remaining(vertexCount, 0);
+    for (unsigned int v : indices)
+        ++offsets[v + 1];
+    for (int v = 0; v < vertexCount; ++v) {
+        remaining[v] = offsets[v + 1];
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<int> adjacency(indices.size());
+    {
+        std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i)
+            adjacency[fill[indices[i]]++] = static_cast<int>(i / 3);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    auto vertexScore = [&](int v) {
+        if (remaining[v] == 0)
+            return -1.0f;
+        float score = 0.0f;
+        int position = cachePosition[v];
+        if (position >= 0) {
+            // The last triangle's vertices get a fixed score so the next triangle
+            // doesn't simply reuse the same edge and strip along forever
+            score = position < 3 ? 0.75f
+                : std::pow(1.0f - (position - 3) * (1.0f / (CacheSize - 3)), 1.5f);
+        }
+        return score + 2.0f / std::sqrt(static_cast<float>(remaining[v]));
+    };
+
+    std::vector<float> scores(vertexCount), triangleScores(triangleCount);
+    for (int v = 0; v < vertexCount; ++v)
+        scores[v] = vertexScore(v);
+    int best = 0;
+    for (int t = 0; t < triangleCount; ++t) {
+        triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+        if (triangleScores[t] > triangleScores[best])
+            best = t;
+    }
+
+    std::vector<unsigned int> ordered;
+    ordered.reserve(indices.size());
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<int> cache, nextCache;
+    int scan = 0;
+    while (best >= 0) {
+        emitted[best] = 1;
+        const unsigned int* triangle = &indices[best * 3];
+        ordered.insert(ordered.end(), triangle, triangle + 3);
+
+        // Drop the triangle from its vertices' remaining lists
+        for (int i = 0; i < 3; ++i) {
+            int v = triangle[i];
+            int* list = &adjacency[offsets[v]];
+            for (int j = 0; j < remaining[v]; ++j) {
+                if (list[j] == best) {
+                    std::swap(list[j], list[remaining[v] - 1]);
+                    break;
+                }
+            }
+            --remaining[v];
+        }
+
+        // Move its vertices to the front of the cache
+        nextCache.assign(triangle, triangle + 3);
+        for (int v : cache) {
+            if (v != static_cast<int>(triangle[0]) && v != static_cast<int>(triangle[1]) && v != static_cast<int>(triangle[2]))
+                nextCache.push_back(v);
+        }
+        for (size_t i = 0; i < nextCache.size(); ++i)
+            cachePosition[nextCache[i]] = i < static_cast<size_t>(CacheSize) ? static_cast<int>(i) : -1;
+
+        // Rescore every vertex whose position changed, and their triangles
+        best = -1;
+        float bestScore = -1.0f;
+        for (int v : nextCache) {
+            scores[v] = vertexScore(v);
+        }
+        for (int v : nextCache) {
+            const int* list = &adjacency[offsets[v]];
+            for (int j = 0; j < remaining[v]; ++j) {
+                int t = list[j];
+                triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+        if (nextCache.size() > static_cast<size_t>(CacheSize))
+            nextCache.resize(CacheSize);
+        cache.swap(nextCache);
+
+        // Nothing left around the cache: continue with the next unemitted triangle
+        if (best < 0) {
+            while (scan < triangleCount && emitted[scan])
+                ++scan;
+            best = scan < triangleCount ? scan : -1;
+        }
+    }
+    indices.swap(ordered);
+}
+
+} // namespace
+
+GridIndices::GridIndices(int width, int depth, Grid_Index_Layout layout) : layout(layout) {
+    int vertexCount = (width + 1) * (depth + 1);
+    // 0xFFFF is the restart index, so 16-bit indices cover 65535 vertices
+    shortIndices = vertexCount <= 0xFFFF;
+    restartIndex = shortIndices ? 0xFFFF : 0xFFFFFFFF;
+
+    std::vector<unsigned int> indices;
+    if (layout == GRID_INDEX_STRIPS) {
+        buildStrips(width, depth, StripBand, restartIndex, indices);
+    }
+    else {
+        buildList(width, depth, indices);
+        if (layout == GRID_INDEX_OPTIMIZED)
+            optimizeForCache(indices, vertexCount);
+    }
+
+    if (shortIndices)
+        indices16.assign(indices.begin(), indices.end());
+    else
+        indices32.swap(indices);
+}
+
+std::vector<unsigned int> GridIndices::triangles() const {
+    std::vector<unsigned int> indices(indices32);
+    if (shortIndices)
+        indices.assign(indices16.begin(), indices16.end());
+    if (layout != GRID_INDEX_STRIPS)
+        return indices;
+
+    std::vector<unsigned int> list;
+    size_t stripStart = 0;
+    for (size_t i = 0; i <= indices.size(); ++i) {
+        if (i < indices.size() && indices[i] != restartIndex)
+            continue;
+        for (size_t j = stripStart; j + 2 < i; ++j) {
+            bool odd = ((j - stripStart) & 1) != 0;
+            list.push_back(indices[odd ? j + 1 : j]);
+            list.push_back(indices[odd ? j : j + 1]);
+            list.push_back(indices[j + 2]);
+        }
+        stripStart = i + 1;
+    }
+    return list;
+}
+
+double GridIndices::acmr(int cacheSize) const {
+    std::vector<unsigned int> list = triangles();
+    if (list.empty())
+        return 0.0;
+
+    // FIFO cache: a hit doesn't move the vertex
+    unsigned int maxIndex = 0;
+    for (unsigned int v : list)
+        maxIndex = std::max(maxIndex, v);
+    std::vector<char> cached(maxIndex + 1, 0);
+    std::vector<unsigned int> fifo(cacheSize);
+    int head = 0, size = 0;
+    long long misses = 0;
+    for (unsigned int v : list) {
+        if (cached[v])
+            continue;
+        ++misses;
+        if (size == cacheSize)
+            cached[fifo[head]] = 0;
+        else
+            ++size;
+        fifo[head] = v;
+        head = (head + 1) % cacheSize;
+        cached[v] = 1;
+    }
+    return static_cast<double>(misses) / (list.size() / 3);
+}
+
+void GridIndices::draw(int instances) const {
+    if (layout == GRID_INDEX_STRIPS) {
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(restartIndex);
+    }
+    if (instances == 1)
+        glDrawElements(primitive(), count(), indexType(), 0);
+    else
+        glDrawElementsInstanced(primitive(), count(), indexType(), 0, instances);
+    if (layout == GRID_INDEX_STRIPS)
+        glDisable(GL_PRIMITIVE_RESTART);
+}
+
+const char* GridIndices::layoutName(Grid_Index_Layout layout) {
+    switch (layout) {
+    case GRID_INDEX_STRIPS:
+        return "strips";
+    case GRID_INDEX_OPTIMIZED:
+        return "optimized";
+    default:
+        return "list";
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef GRID_INDICES_H
+#define GRID_INDICES_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// Triangle order of a grid's index buffer. Every layout draws the same
+// triangles, each quad split along its (x + 1, z)-(x, z + 1) diagonal (the
+// LOD morph targets assume that diagonal) with the same winding.
+enum Grid_Index_Layout {
+    GRID_INDEX_LIST,     // Row-major triangle list: 6 indices per quad
+    GRID_INDEX_STRIPS,   // Triangle strips along rows of narrow column bands, joined with
+                         // primitive restart: about 2.5 indices per quad, and each row reuses
+                         // the vertices of the row before it from the post-transform cache
+    GRID_INDEX_OPTIMIZED // Triangle list reordered for the post-transform cache with Tom
+                         // Forsyth's linear-speed vertex cache optimisation
+};
+
+// Index buffer for a (width + 1) x (depth + 1) vertex grid. Indices are 16-bit
+// whenever the vertices fit (0xFFFF stays free as the restart index), so a
+// 32x32-quad chunk in strips takes about 5 KB instead of 24 KB.
+class GridIndices {
+public:
+    GridIndices() {}
+    GridIndices(int width, int depth, Grid_Index_Layout layout);
+
+    Grid_Index_Layout getLayout() const { return layout; }
+    GLenum primitive() const { return layout == GRID_INDEX_STRIPS ? GL_TRIANGLE_STRIP : GL_TRIANGLES; }
+    GLenum indexType() const { return shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+    int count() const { return static_cast<int>(shortIndices ? indices16.size() : indices32.size()); }
+    size_t byteSize() const { return shortIndices ? indices16.size() * 2 : indices32.size() * 4; }
+    const void* data() const {
+        return shortIndices ? static_cast<const void*>(indices16.data()) : static_cast<const void*>(indices32.data());
+    }
+
+    // The triangles drawn, three vertex indices each, in draw order
+    std::vector<unsigned int> triangles() const;
+    // Average cache miss ratio: vertices transformed per triangle drawn with a
+    // FIFO post-transform cache of cacheSize entries (0.5 is the ideal for a
+    // large grid, 3 means no reuse at all)
+    double acmr(int cacheSize = 32) const;
+
+    // Draws with these indices; the bound VAO must have them as its element array
+    void draw(int instances = 1) const;
+
+    static const char* layoutName(Grid_Index_Layout layout);
+
+private:
+    // Quads per column band of GRID_INDEX_STRIPS: a band row and the one
+    // before it (2 * (StripBand + 1) = 16 vertices) fit even a 16-entry cache
+    static const int StripBand = 7;
+
+    Grid_Index_Layout layout = GRID_INDEX_LIST;
+    bool shortIndices = false;
+    unsigned int restartIndex = 0;
+    std::vector<unsigned short> indices16;
+    std::vector<unsigned int> indices32;
+};
+
+#endif // GRID_INDICES_H
@@ -0,0 +1,180 @@
+#include "height_quadtree.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// Narrows [tEnter, tExit] to the part of the ray inside the box; false if none is
+bool clipRay(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& boxMin,
+    const glm::vec3& boxMax, float& tEnter, float& tExit) {
+    for (int axis = 0; axis < 3; ++axis) {
+        if (direction[axis] == 0.0f) {
+            if (origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis])
+                return false;
+            continue;
+        }
+        float t0 = (boxMin[axis] - origin[axis]) / direction[axis];
+        float t1 = (boxMax[axis] - origin[axis]) / direction[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        tEnter = std::max(tEnter, t0);
+        tExit = std::min(tExit, t1);
+        if (tEnter > tExit)
+            return false;
+    }
+    return true;
+}
+
+// Moller-Trumbore, from either side
+bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a,
+    const glm::vec3& b, const glm::vec3& c, float& t) {
+    // Slack so rays through a shared edge hit one of its triangles
+    const float tolerance = 1e-5f;
+    glm::vec3 edge1 = b - a, edge2 = c - a;
+    glm::vec3 p = glm::cross(direction, edge2);
+    float determinant = glm::dot(edge1, p);
+    if (determinant == 0.0f)
+        return false;
+    float inverse = 1.0f / determinant;
+    glm::vec3 s = origin - a;
+    float u = glm::dot(s, p) * inverse;
+    if (u < -tolerance || u > 1.0f + tolerance)
+        return false;
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(direction, q) * inverse;
+    if (v < -tolerance || u + v > 1.0f + tolerance)
+        return false;
+    t = glm::dot(edge2, q) * inverse;
+    return t >= 0.0f;
+}
+
+} // namespace
+
+void HeightQuadtree::build(int width, int depth, const float* heights, int stride) {
+    this->width = width;
+    this->depth = depth;
+    levels.clear();
+    for (int level = 1; levelWidth(level - 1) > 1 || levelDepth(level - 1) > 1; ++level)
+        levels.emplace_back(levelWidth(level) * levelDepth(level));
+    update(0, 0, width, depth, heights, stride);
+}
+
+void HeightQuadtree::update(int x0, int z0, int x1, int z1, const float* heights, int stride) {
+    for (int level = 1; level <= static_cast<int>(levels.size()); ++level) {
+        // Parents of the changed nodes one level down
+        x0 >>= 1;
+        z0 >>= 1;
+        x1 = (x1 + 1) >> 1;
+        z1 = (z1 + 1) >> 1;
+        int childWidth = levelWidth(level - 1), childDepth = levelDepth(level - 1);
+        std::vector<glm::vec2>& nodes = levels[level - 1];
+        for (int z = z0; z < z1; ++z) {
+            for (int x = x0; x < x1; ++x) {
+                glm::vec2 node(FLT_MAX, -FLT_MAX);
+                for (int cz = 2 * z; cz < std::min(2 * z + 2, childDepth); ++cz) {
+                    for (int cx = 2 * x; cx < std::min(2 * x + 2, childWidth); ++cx) {
+                        glm::vec2 child = range(level - 1, cx, cz, heights, stride);
+                        node.x = std::min(node.x, child.x);
+                        node.y = std::max(node.y, child.y);
+                    }
+                }
+                nodes[x + z * levelWidth(level)] = node;
+            }
+        }
+    }
+}
+
+glm::vec2 HeightQuadtree::range(int level, int x, int z, const float* heights, int stride) const {
+    if (level > 0)
+        return levels[level - 1][x + z * levelWidth(level)];
+    int row = width + 1;
+    float h00 = heights[(x + z * row) * stride], h10 = heights[(x + 1 + z * row) * stride];
+    float h01 = heights[(x + (z + 1) * row) * stride], h11 = heights[(x + 1 + (z + 1) * row) * stride];
+    return glm::vec2(std::min(std::min(h00, h10), std::min(h01, h11)), std::max(std::max(h00, h10), std::max(h01, h11)));
+}
+
+float HeightQuadtree::heightAt(float x, float z, const float* heights, int stride) const {
+    int qx = std::min(std::max(static_cast<int>(std::floor(x)), 0), width - 1);
+    int qz = std::min(std::max(static_cast<int>(std::floor(z)), 0), depth - 1);
+    float fx = x - qx, fz = z - qz;
+    int row = width + 1;
+    float h00 = heights[(qx + qz * row) * stride], h10 = heights[(qx + 1 + qz * row) * stride];
+    float h01 = heights[(qx + (qz + 1) * row) * stride], h11 = heights[(qx + 1 + (qz + 1) * row) * stride];
+    // Interpolate on the triangle of the quad the point falls in
+    if (fx + fz <= 1.0f)
+        return h00 + fx * (h10 - h00) + fz * (h01 - h00);
+    return h11 + (1.0f - fx) * (h01 - h11) + (1.0f - fz) * (h10 - h11);
+}
+
+bool HeightQuadtree::intersectQuad(int x, int z, const glm::vec3& origin, const glm::vec3& direction,
+    const float* heights, int stride, float& t) const {
+    int row = width + 1;
+    glm::vec3 v00(x, heights[(x + z * row) * stride], z);
+    glm::vec3 v10(x + 1, heights[(x + 1 + z * row) * stride], z);
+    glm::vec3 v01(x, heights[(x + (z + 1) * row) * stride], z + 1);
+    glm::vec3 v11(x + 1, heights[(x + 1 + (z + 1) * row) * stride], z + 1);
+
+    float t0, t1;
+    bool hit0 = intersectTriangle(origin, direction, v00, v10, v01, t0);
+    bool hit1 = intersectTriangle(origin, direction, v10, v11, v01, t1);
+    if (!hit0 && !hit1)
+        return false;
+    t = hit0 && hit1 ? std::min(t0, t1) : (hit0 ? t0 : t1);
+    return true;
+}
+
+bool HeightQuadtree::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxT,
+    const float* heights, int stride, float& t) const {
+    struct Node {
+        int level, x, z;
+    };
+    if (width <= 0 || depth <= 0)
+        return false;
+
+    // Children are pushed far to near, so the nearest is searched first and
+    // its hit prunes the rest
+    int nearX = direction.x < 0.0f ? 1 : 0;
+    int nearZ = direction.z < 0.0f ? 1 : 0;
+    const int order[4][2] = { { 1 - nearX, 1 - nearZ }, { nearX, 1 - nearZ }, { 1 - nearX, nearZ }, { nearX, nearZ } };
+
+    std::vector<Node> stack;
+    stack.reserve(4 * levels.size() + 1);
+    stack.push_back({ static_cast<int>(levels.size()), 0, 0 });
+    bool hit = false;
+    float best = maxT;
+    while (!stack.empty()) {
+        Node node = stack.back();
+        stack.pop_back();
+
+        int size = 1 << node.level;
+        glm::vec2 heightRange = range(node.level, node.x, node.z, heights, stride);
+        // Padded a little so rounding never lets a ray slip past a quad it touches
+        float pad = 1e-4f * (1.0f + std::max(std::abs(heightRange.x), std::abs(heightRange.y)));
+        glm::vec3 boxMin(node.x * size - 1e-4f, heightRange.x - pad, node.z * size - 1e-4f);
+        glm::vec3 boxMax(std::min((node.x + 1) * size, width) + 1e-4f, heightRange.y + pad,
+            std::min((node.z + 1) * size, depth) + 1e-4f);
+        float tEnter = 0.0f, tExit = best;
+        if (!clipRay(origin, direction, boxMin, boxMax, tEnter, tExit))
+            continue;
+
+        if (node.level == 0) {
+            float quadT;
+            if (intersectQuad(node.x, node.z, origin, direction, heights, stride, quadT) && quadT <= best) {
+                best = quadT;
+                hit = true;
+            }
+            continue;
+        }
+
+        int childWidth = levelWidth(node.level - 1), childDepth = levelDepth(node.level - 1);
+        for (const int* child : order) {
+            int cx = 2 * node.x + child[0], cz = 2 * node.z + child[1];
+            if (cx < childWidth && cz < childDepth)
+                stack.push_back({ node.level - 1, cx, cz });
+        }
+    }
+    if (hit)
+        t = best;
+    return hit;
+}
@@ -0,0 +1,46 @@
+#ifndef HEIGHT_QUADTREE_H
+#define HEIGHT_QUADTREE_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Min/max height pyramid (a "maximum mipmap") over the quads of a
+// (width + 1) x (depth + 1) vertex heightfield. Node (level, x, z) holds the
+// height range of the 2^level x 2^level quads starting at quad (x, z) * 2^level;
+// single quads (level 0) are read straight from their four corners. A ray only
+// descends into nodes whose box it enters before its nearest hit so far, so a
+// query tests a logarithmic number of nodes instead of scanning every quad.
+//
+// Coordinates are in grid space: x and z in quads from the first vertex, y in
+// height units. Quads are split along their (x + 1, z)-(x, z + 1) diagonal, as
+// the terrain's index buffers draw them. Heights are passed to every call
+// (vertex (x, z) at heights[(x + z * (width + 1)) * stride]) rather than
+// stored, as they live in the owner's vertex array.
+class HeightQuadtree {
+public:
+    HeightQuadtree() {}
+
+    void build(int width, int depth, const float* heights, int stride);
+    // Refreshes the nodes over quads [x0, x1) x [z0, z1) after heights changed there
+    void update(int x0, int z0, int x1, int z1, const float* heights, int stride);
+
+    // Height of the surface at grid (x, z), which must lie on the grid
+    float heightAt(float x, float z, const float* heights, int stride) const;
+
+    // Nearest t in [0, maxT] at which origin + t * direction meets the surface
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxT,
+        const float* heights, int stride, float& t) const;
+
+private:
+    int width = 0, depth = 0;
+    // levels[l - 1] holds level l, row by row; the last level is a single node
+    std::vector<std::vector<glm::vec2>> levels;
+
+    int levelWidth(int level) const { return (width + (1 << level) - 1) >> level; }
+    int levelDepth(int level) const { return (depth + (1 << level) - 1) >> level; }
+    glm::vec2 range(int level, int x, int z, const float* heights, int stride) const;
+    bool intersectQuad(int x, int z, const glm::vec3& origin, const glm::vec3& direction,
+        const float* heights, int stride, float& t) const;
+};
+
+#endif // HEIGHT_QUADTREE_H
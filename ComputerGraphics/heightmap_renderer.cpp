@@ -0,0 +1,168 @@
+#include "heightmap_renderer.h"
+#include "gl_buffer.h"
+#include <cstddef>
+
+HeightmapRenderer::HeightmapRenderer(int gridSize, int initialLayers) : gridSize(gridSize) {
+    // Shared grid mesh: just the grid coordinates of every vertex
+    std::vector<unsigned short> grid;
+    grid.reserve((gridSize + 1) * (gridSize + 1) * 2);
+    for (int z = 0; z <= gridSize; ++z) {
+        for (int x = 0; x <= gridSize; ++x) {
+            grid.push_back(static_cast<unsigned short>(x));
+            grid.push_back(static_cast<unsigned short>(z));
+        }
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &gridVBO);
+    glGenBuffers(1, &instanceVBO);
+
+    glBindVertexArray(VAO);
+
+    indexBuffer = SharedIndexBuffer::acquire(gridSize, gridSize, TERRAIN_INDEX_LAYOUT);
+    indexBuffer->bind();
+
+    // Grid coordinate attribute (same location as the compact vertex format's)
+    glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+    glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(unsigned short), grid.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(4, 2, GL_UNSIGNED_SHORT, GL_FALSE, 2 * sizeof(unsigned short), (void*)0);
+    glEnableVertexAttribArray(4);
+
+    // Per-instance attributes: grid origin, scale and layer, then morph range
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, gridOriginX));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+    glVertexAttribPointer(8, 2, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, morphStart));
+    glEnableVertexAttribArray(8);
+    glVertexAttribDivisor(8, 1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    createTexture(initialLayers);
+}
+
+HeightmapRenderer::~HeightmapRenderer() {
+    glDeleteTextures(1, &heightTexture);
+    glDeleteTextures(1, &normalTexture);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &gridVBO);
+    glDeleteBuffers(1, &instanceVBO);
+}
+
+namespace {
+
+unsigned int createTextureArray(GLenum internalFormat, GLenum format, int size, int layers) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, size, size, layers, 0, format, GL_FLOAT, nullptr);
+    // Only read with texelFetch, but the texture must still be complete
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return texture;
+}
+
+} // namespace
+
+void HeightmapRenderer::createTexture(int layers) {
+    heightTexture = createTextureArray(GL_R32F, GL_RED, gridSize + 1, layers);
+    // Normal x and z; half floats are plenty for a unit vector and, unlike
+    // 8-bit snorm, are color-renderable in GL 3.3 so growTexture can copy them
+    normalTexture = createTextureArray(GL_RG16F, GL_RG, gridSize + 1, layers);
+
+    for (int layer = layers - 1; layer >= layerCapacity; --layer)
+        freeLayers.push_back(layer);
+    layerCapacity = layers;
+}
+
+void HeightmapRenderer::growTexture() {
+    // Double the arrays and copy the old layers across through a read framebuffer
+    // (glCopyImageSubData needs GL 4.3)
+    unsigned int oldTextures[2] = { heightTexture, normalTexture };
+    int oldCapacity = layerCapacity;
+    createTexture(oldCapacity * 2);
+    unsigned int newTextures[2] = { heightTexture, normalTexture };
+
+    GLint previousReadFBO;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFBO);
+    unsigned int readFBO;
+    glGenFramebuffers(1, &readFBO);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+    for (int i = 0; i < 2; ++i) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, newTextures[i]);
+        for (int layer = 0; layer < oldCapacity; ++layer) {
+            glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, oldTextures[i], 0, layer);
+            glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0, 0, gridSize + 1, gridSize + 1);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previousReadFBO);
+    glDeleteFramebuffers(1, &readFBO);
+    glDeleteTextures(2, oldTextures);
+}
+
+int HeightmapRenderer::addLayer(const Terrain& terrain) {
+    if (freeLayers.empty())
+        growTexture();
+    int layer = freeLayers.back();
+    freeLayers.pop_back();
+    updateLayer(layer, terrain, 0, gridSize + 1);
+    return layer;
+}
+
+void HeightmapRenderer::updateLayer(int layer, const Terrain& terrain, int zBegin, int zEnd) {
+    std::vector<float> heights = terrain.getHeights(zBegin, zEnd);
+    std::vector<float> normals = terrain.getNormalsXZ(zBegin, zEnd);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, heightTexture);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, zBegin, layer, gridSize + 1, zEnd - zBegin, 1,
+        GL_RED, GL_FLOAT, heights.data());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, normalTexture);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, zBegin, layer, gridSize + 1, zEnd - zBegin, 1,
+        GL_RG, GL_FLOAT, normals.data());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void HeightmapRenderer::removeLayer(int layer) {
+    freeLayers.push_back(layer);
+}
+
+HeightmapRenderer::Instance HeightmapRenderer::makeInstance(const Terrain& terrain, int layer,
+    float morphStart, float morphEnd) const {
+    Instance instance;
+    instance.gridOriginX = static_cast<float>(terrain.getOriginX());
+    instance.gridOriginZ = static_cast<float>(terrain.getOriginZ());
+    instance.gridScale = terrain.getGridScale();
+    instance.layer = static_cast<float>(layer);
+    instance.morphStart = morphStart;
+    instance.morphEnd = morphEnd;
+    return instance;
+}
+
+void HeightmapRenderer::Draw(Shader& shader, const std::vector<Instance>& instances) {
+    if (instances.empty())
+        return;
+
+    shader.setInt("vertexFormat", TERRAIN_VERTEX_HEIGHTMAP);
+    shader.setVec2("gridSize", static_cast<float>(gridSize), static_cast<float>(gridSize));
+    shader.setInt("heightmaps", 0);
+    shader.setInt("normalmaps", 1);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, normalTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, heightTexture);
+
+    orphanAndUpload(GL_ARRAY_BUFFER, instanceVBO, instances.size() * sizeof(Instance), instances.data());
+
+    glBindVertexArray(VAO);
+    indexBuffer->draw(static_cast<int>(instances.size()));
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
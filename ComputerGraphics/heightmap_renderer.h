@@ -0,0 +1,59 @@
+#ifndef HEIGHTMAP_RENDERER_H
+#define HEIGHTMAP_RENDERER_H
+
+#include <glad/glad.h>
+#include <vector>
+#include "shader.h"
+#include "terrain.h"
+
+// Renders TERRAIN_VERTEX_HEIGHTMAP terrains. Each terrain's heights occupy one
+// layer of a single R32F texture array (and its normals the same layer of an
+// RG16F one); one (gridSize + 1)^2 grid mesh is shared
+// by all of them and drawn once per frame with an instance per terrain. The
+// vertex shader fetches heights (and LOD morph targets) from the texture, so
+// terrains need no vertex or index buffers of their own and edits are a
+// texture sub-upload.
+class HeightmapRenderer {
+public:
+    // Per-terrain data for one instanced draw
+    struct Instance {
+        float gridOriginX, gridOriginZ; // Grid coordinates of the terrain's first vertex
+        float gridScale;                // World units per quad
+        float layer;                    // Texture array layer holding the heights
+        float morphStart, morphEnd;     // LOD morph range
+    };
+
+    // gridSize: quads per side of every terrain drawn (GL thread only)
+    explicit HeightmapRenderer(int gridSize, int initialLayers = 64);
+    ~HeightmapRenderer();
+
+    HeightmapRenderer(const HeightmapRenderer&) = delete;
+    HeightmapRenderer& operator=(const HeightmapRenderer&) = delete;
+
+    // Uploads a terrain's heights into a free layer (growing the texture array
+    // if needed) and returns the layer
+    int addLayer(const Terrain& terrain);
+    // Re-uploads rows [zBegin, zEnd) of a layer after the terrain was edited
+    void updateLayer(int layer, const Terrain& terrain, int zBegin, int zEnd);
+    void removeLayer(int layer);
+
+    Instance makeInstance(const Terrain& terrain, int layer, float morphStart, float morphEnd) const;
+
+    // Draws every instance with one glDrawElementsInstanced call
+    void Draw(Shader& shader, const std::vector<Instance>& instances);
+
+private:
+    int gridSize;
+    int layerCapacity = 0;
+    std::vector<int> freeLayers;
+
+    unsigned int heightTexture = 0, normalTexture = 0;
+    unsigned int VAO = 0, gridVBO = 0, instanceVBO = 0;
+    // The same buffer the chunks of a vertex-buffer format use
+    std::shared_ptr<SharedIndexBuffer> indexBuffer;
+
+    void createTexture(int layers);
+    void growTexture();
+};
+
+#endif // HEIGHTMAP_RENDERER_H
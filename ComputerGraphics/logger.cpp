@@ -0,0 +1,153 @@
+#include "logger.h"
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+const char* levelPrefix(Log_Level level) {
+    switch (level) {
+    case LOG_DEBUG:
+        return "debug: ";
+    case LOG_WARNING:
+        return "warning: ";
+    case LOG_ERROR:
+        return "error: ";
+    default:
+        return "";
+    }
+}
+
+// How long the writer sleeps when there is nothing to write; the latest a
+// message can appear
+const std::chrono::milliseconds WriterIdle(10);
+
+} // namespace
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() : output(&std::cout), epoch(std::chrono::steady_clock::now()) {
+    for (size_t i = 0; i < Capacity; ++i)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    writer = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger() {
+    stopping = true;
+    wake.notify_one();
+    writer.join();
+}
+
+bool Logger::push(Log_Level level, std::string message) {
+    Slot* slot;
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &slots[position & (Capacity - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+        if (difference == 0) {
+            // Free; claim it unless another producer got there first
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0) {
+            // The writer has not emptied this slot since the last lap: full
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+    slot->message = std::move(message);
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    // Don't leave a burst waiting for the writer's next timeout
+    if ((position & (Capacity / 2 - 1)) == 0)
+        wake.notify_one();
+    return true;
+}
+
+void Logger::flush() {
+    size_t queued = enqueuePosition.load(std::memory_order_acquire);
+    wake.notify_one();
+    while (written.load(std::memory_order_acquire) < queued)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void Logger::run() {
+    for (;;) {
+        bool stop = stopping.load();
+        if (drain() > 0)
+            continue;
+        if (stop)
+            return;
+        // A producer is between claiming a slot and filling it
+        if (enqueuePosition.load(std::memory_order_acquire) != dequeuePosition) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wake.wait_for(lock, WriterIdle);
+    }
+}
+
+size_t Logger::drain() {
+    size_t count = 0;
+    std::string message;
+    for (;;) {
+        Slot& slot = slots[dequeuePosition & (Capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1)
+            break;
+        Log_Level level = slot.level;
+        double seconds = slot.seconds;
+        // Swap rather than copy, so the slot keeps a buffer for the next lap
+        message.swap(slot.message);
+        slot.sequence.store(dequeuePosition + Capacity, std::memory_order_release);
+        ++dequeuePosition;
+
+        char time[32];
+        std::snprintf(time, sizeof(time), "[%9.3f] ", seconds);
+        *output << time << levelPrefix(level) << message << '\n';
+        ++count;
+    }
+
+    size_t lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0)
+        *output << "warning: log buffer full, " << lost << " messages dropped\n";
+    if (count > 0 || lost > 0)
+        output->flush();
+    written.fetch_add(count, std::memory_order_release);
+    return count;
+}
+
+LogRateLimit::LogRateLimit(double intervalSeconds)
+    : interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(intervalSeconds))) {
+}
+
+bool LogRateLimit::allow() {
+    std::chrono::steady_clock::rep now = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::chrono::steady_clock::rep due = next.load(std::memory_order_relaxed);
+    // Of several threads arriving at once, only the one that moves next on wins
+    if (now < due || !next.compare_exchange_strong(due, now + interval.count(), std::memory_order_relaxed)) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+LogLine::~LogLine() {
+    if (limit) {
+        size_t suppressed = limit->takeSuppressed();
+        if (suppressed > 0)
+            text << " (" << suppressed << " similar messages suppressed)";
+    }
+    Logger::instance().push(level, text.str());
+}
@@ -0,0 +1,130 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+enum Log_Level {
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARNING,
+    LOG_ERROR
+};
+
+// Asynchronous process-wide logger. Any thread formats its message and pushes
+// it into a fixed-size ring buffer without taking a lock; a background thread
+// drains the ring and does the (possibly slow) console I/O, so logging never
+// blocks the render loop. If the ring is full the message is dropped and the
+// writer reports how many were lost.
+//
+// Log through the LOG and LOG_LIMITED macros, which skip formatting entirely
+// for levels below the current minimum.
+class Logger {
+public:
+    static Logger& instance();
+
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    static bool enabled(Log_Level level) { return level >= instance().minimumLevel.load(std::memory_order_relaxed); }
+    void setLevel(Log_Level level) { minimumLevel = level; }
+    // Where the writer sends messages (std::cout by default). Call before
+    // logging starts, e.g. at the top of main().
+    void setOutput(std::ostream& out) { output = &out; }
+
+    // Queues a message; false if the ring was full and it was dropped
+    bool push(Log_Level level, std::string message);
+    // Waits until everything queued so far is written
+    void flush();
+
+private:
+    static const size_t Capacity = 1024; // power of two
+
+    // Bounded multi-producer queue (Vyukov): a slot is free for the producer
+    // that claims position p once its sequence is p, and holds a message for
+    // the writer once its sequence is p + 1
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Log_Level level;
+        double seconds;
+        std::string message;
+    };
+
+    Slot slots[Capacity];
+    std::atomic<size_t> enqueuePosition{ 0 };
+    size_t dequeuePosition = 0; // writer thread only
+    std::atomic<size_t> dropped{ 0 };
+    std::atomic<size_t> written{ 0 };
+
+    std::atomic<int> minimumLevel{ LOG_INFO };
+    std::ostream* output;
+    std::chrono::steady_clock::time_point epoch;
+
+    // Only the writer waits on these; producers never touch the mutex
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping{ false };
+    std::thread writer;
+
+    Logger();
+    void run();
+    // Writes every queued message; returns how many
+    size_t drain();
+};
+
+// Lets through at most one message per interval from the call sites sharing
+// it, and counts the rest so the next message that gets through can say how
+// many were suppressed
+class LogRateLimit {
+public:
+    explicit LogRateLimit(double intervalSeconds);
+
+    bool allow();
+    // Suppressed since the last allowed message, reset to 0
+    size_t takeSuppressed() { return suppressed.exchange(0); }
+
+private:
+    std::chrono::steady_clock::duration interval;
+    std::atomic<std::chrono::steady_clock::rep> next{ 0 };
+    std::atomic<size_t> suppressed{ 0 };
+};
+
+// One message, queued when it goes out of scope
+class LogLine {
+public:
+    LogLine(Log_Level level, LogRateLimit* limit = nullptr) : level(level), limit(limit) {}
+    ~LogLine();
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    std::ostringstream& stream() { return text; }
+
+private:
+    Log_Level level;
+    LogRateLimit* limit;
+    std::ostringstream text;
+};
+
+// Turns the streamed line into a void expression, so the macros below are a
+// single ?: expression and nest safely in an unbraced if/else
+struct LogVoidify {
+    void operator&(std::ostream&) {}
+};
+
+// LOG(LOG_INFO) << "Loaded " << count << " chunks";
+#define LOG(level) \
+    !Logger::enabled(level) ? (void)0 : LogVoidify() & LogLine(level).stream()
+// static LogRateLimit cameraLog(1.0); LOG_LIMITED(LOG_DEBUG, cameraLog) << ...;
+#define LOG_LIMITED(level, limit) \
+    !Logger::enabled(level) || !(limit).allow() ? (void)0 : LogVoidify() & LogLine(level, &(limit)).stream()
+
+#endif // LOGGER_H
@@ -3,15 +3,55 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
 #include "shader.h"
+#include "shader_manager.h"
 #include "camera.h"
-#include "terrain.h"
+#include "chunk_manager.h"
+#include "prop_renderer.h"
+#include "frame_uniforms.h"
+#include "benchmark.h"
+#include "gpu_timer.h"
+#include "logger.h"
+#include "profiler.h"
+#include "profiler_overlay.h"
+#include "text.h"
 #include "sphere.h"  // Assuming a sphere class or model is available
 
 // Window dimensions
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
 
+// Terrain vertex layout (TERRAIN_VERTEX_FULL for the uncompressed A/B baseline,
+// TERRAIN_VERTEX_HEIGHTMAP to instance one grid mesh over a height texture array)
+const Terrain_Vertex_Format TERRAIN_VERTEX_FORMAT = TERRAIN_VERTEX_COMPACT;
+const char* const TERRAIN_VERTEX_FORMAT_NAMES[] = { "full", "compact", "heightmap" };
+
+// Benchmark mode (--benchmark [frames]): renders offscreen along a scripted
+// camera path and prints frame timings as JSON on stdout
+bool benchmarkMode = false;
+int benchmarkFrames = 1000;
+// Load and save terrain chunks in TERRAIN_CACHE_DIRECTORY; on outside
+// benchmark mode unless the seed is random, opt-in (--tile-cache) inside it
+bool useTileCache = false;
+// Terrain noise seed outside benchmark mode (--seed N). The same landscape on
+// every launch, so chunks cached by one run are read by the next; --seed random
+// picks a new one each time and leaves the tile cache off.
+unsigned int terrainSeed = 1;
+bool randomSeed = false;
+// Per-phase frame timings are written here on exit (--trace <file>): CSV for
+// a .csv file, Chrome trace JSON otherwise
+std::string tracePath;
+
+// Frame-time overlay, toggled with F3
+bool showProfiler = true;
+bool profilerKeyDown = false;
+
 // Camera
 Camera camera(glm::vec3(0.0f, 50.0f, 100.0f));
 float lastX = SCR_WIDTH / 2.0f;
@@ -28,10 +68,17 @@ float timeOfDay = 0.0f; // 0.0 to 1.0
 float sunSpeed = 0.1f;
 
 // Function prototypes
+GLFWwindow* createWindow(bool offscreen);
+void renderScene(ChunkManager& terrain, PropRenderer& props, Shader& terrainShader, Shader& propShader,
+    Shader& lightShader, Sphere& sun, FrameUniforms& frameUniforms, const glm::mat4& projection,
+    const glm::mat4& view, Profiler& profiler);
+int runBenchmark(GLFWwindow* window, ChunkManager& terrain, PropRenderer& props, ShaderManager& shaders,
+    Shader& terrainShader, Shader& propShader, Shader& lightShader, Sphere& sun, FrameUniforms& frameUniforms);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
+void editTerrain(GLFWwindow* window, ChunkManager& terrain, PropRenderer& props);
 glm::vec3 getSkyboxColor(float timeOfDay);
 
 // Function to update the light position based on time of day
@@ -52,31 +99,60 @@ void updateSunPosition() {
     if (timeOfDay > 1.0f) timeOfDay = 0.0f;
 }
 
-int main() {
-    // GLFW: initialize and configure
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--benchmark") == 0) {
+            benchmarkMode = true;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+                benchmarkFrames = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--tile-cache") == 0) {
+            useTileCache = true;
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            ++i;
+            if (std::strcmp(argv[i], "random") == 0)
+                randomSeed = true;
+            else
+                terrainSeed = static_cast<unsigned int>(std::strtoul(argv[i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--verbose") == 0) {
+            Logger::instance().setLevel(LOG_DEBUG);
+        }
+    }
+
+    // Keep stdout for the JSON report in benchmark mode
+    if (benchmarkMode)
+        Logger::instance().setOutput(std::cerr);
 
     // GLFW window creation
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Fantasy Landscape", NULL, NULL);
+    GLFWwindow* window = createWindow(benchmarkMode);
     if (window == NULL) {
-        std::cout << "Failed to create GLFW window" << std::endl;
+        LOG(LOG_ERROR) << "Failed to create GLFW window";
         glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
 
-    // Tell GLFW to capture mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (benchmarkMode) {
+        // Don't let vsync cap the measured frame rate
+        glfwSwapInterval(0);
+    }
+    else {
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+
+        // Tell GLFW to capture mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
 
     // GLAD: load OpenGL function pointers
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
+        LOG(LOG_ERROR) << "Failed to initialize GLAD";
         return -1;
     }
 
@@ -85,93 +161,298 @@ int main() {
 
 
 
-    // Build and compile shaders
-    Shader terrainShader("terrain_vertex.glsl", "terrain_fragment.glsl");
-    Shader lightShader("light_vertex.glsl", "light_fragment.glsl");
+    // Submit every shader compile up front; the driver works on them while the
+    // terrain starts streaming in, and each program is waited for on first use
+    ShaderManager shaders;
+    Shader& terrainShader = shaders.load("terrain_vertex.glsl", "terrain_fragment.glsl");
+    Shader& propShader = shaders.load("prop_vertex.glsl", "prop_fragment.glsl");
+    Shader& lightShader = shaders.load("light_vertex.glsl", "light_fragment.glsl");
+
+    // View, projection, light and camera position, shared by all programs
+    FrameUniforms frameUniforms;
+
+    LOG(LOG_INFO) << "Shader compilation started" << (ShaderManager::parallelCompileSupported() ? " (parallel)" : "");
+
+    // Create terrain: 32x32-quad chunks in a 6-level LOD quadtree streamed around the camera
+    // (the benchmark always uses the same landscape)
+    unsigned int seed = benchmarkMode ? BENCHMARK_SEED : randomSeed ? std::random_device()() : terrainSeed;
+    ChunkManager terrain(32, 10.0f, 6, 1024, seed);
+    terrain.setVertexFormat(TERRAIN_VERTEX_FORMAT);
+    // Reuse chunks generated on earlier runs with the same seed; the benchmark
+    // measures generation from scratch unless asked to use the cache too
+    if (benchmarkMode ? useTileCache : !randomSeed)
+        terrain.enableTileCache();
 
-    std::cout << "Shader generated successfully\n" << std::endl;
+    LOG(LOG_INFO) << "Terrain streaming started (seed " << terrain.seed() << ")";
 
-    // Create terrain
-    Terrain terrain(200, 200, 10.0f);
+    // Vertex reuse of the chunk index buffer against a plain triangle list
+    GridIndices chunkIndices(terrain.getChunkSize(), terrain.getChunkSize(), TERRAIN_INDEX_LAYOUT);
+    GridIndices listIndices(terrain.getChunkSize(), terrain.getChunkSize(), GRID_INDEX_LIST);
+    LOG(LOG_INFO) << "Chunk indices: " << GridIndices::layoutName(chunkIndices.getLayout()) << ", "
+        << chunkIndices.count() << (chunkIndices.indexType() == GL_UNSIGNED_SHORT ? " x 16-bit" : " x 32-bit")
+        << ", ACMR " << chunkIndices.acmr() << " (triangle list: " << listIndices.count() << ", ACMR "
+        << listIndices.acmr() << ")";
 
-    std::cout << "Terrain generated successfully\n" << std::endl;
+    // Trees and rocks, placed the same way for the same terrain seed
+    PropRenderer props(terrain.seed());
 
     // Create a sphere for the sun
     Sphere sun(100, 36, 18); // radius, sectors, stacks
 
+    if (benchmarkMode) {
+        int result = runBenchmark(window, terrain, props, shaders, terrainShader, propShader, lightShader, sun,
+            frameUniforms);
+        glfwTerminate();
+        return result;
+    }
+
+    // Frame-time overlay
+    Shader& overlayShader = shaders.load("overlay_vertex.glsl", "overlay_fragment.glsl");
+    Shader& textShader = shaders.load("text_vertex.glsl", "text_fragment.glsl");
+    TextRenderer text(textShader, TEXT_FONT_PATH);
+    if (!text.loaded())
+        LOG(LOG_WARNING) << "Could not load font " << TEXT_FONT_PATH << "; the profiler overlay shows no text";
+    else
+        LOG(LOG_DEBUG) << "Glyph atlas " << (text.atlasCached() ? "loaded from " : "packed and saved to ")
+            << TEXT_ATLAS_CACHE_DIRECTORY;
+    ProfilerOverlay overlay(overlayShader, text);
+    Profiler profiler;
+    profiler.setRecording(!tracePath.empty());
+
+    // Pick up edits to the GLSL files without restarting (and regenerating the terrain)
+    shaders.enableHotReload();
+
+    LogRateLimit positionLog(1.0);
+
     // Render loop
     while (!glfwWindowShouldClose(window)) {
         // Per-frame time logic
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        profiler.beginFrame();
 
         // Input
+        profiler.begin(PROFILE_INPUT);
         processInput(window);
+        editTerrain(window, terrain, props);
+
+        // Keep the camera above the ground
+        float groundHeight;
+        if (terrain.heightAt(camera.Position.x, camera.Position.z, groundHeight))
+            camera.Position.y = std::max(camera.Position.y, groundHeight + 2.0f);
+        profiler.end(PROFILE_INPUT);
+
+        profiler.begin(PROFILE_UPDATE);
+        // Recompile edited shaders; a program is only replaced once it links
+        shaders.reloadChanged();
 
         // Update lighting and sun position
         updateSunPosition();
         updateLightPosition();
 
-		//std::cout << "Sun position: " << lightPos.x << ", " << lightPos.y << ", " << lightPos.z << std::endl;
-		//std::cout << "Light Position: " << lightPos.x << ", " << lightPos.y << ", " << lightPos.z << std::endl;
-		std::cout << "Camera Position: " << camera.Position.x << ", " << camera.Position.y << ", " << camera.Position.z << std::endl;
-
-        glm::vec3 skyboxColor = getSkyboxColor(timeOfDay);
-
-
-        // Render
-        glClearColor(skyboxColor.r, skyboxColor.g, skyboxColor.b, 1.0f); // Use skybox color
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Activate terrain shader
-        terrainShader.use();
-
         // View/projection transformations
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
             (float)SCR_WIDTH / (float)SCR_HEIGHT,
-            0.1f, 1000.0f);
+            1.0f, terrain.viewDistance());
         glm::mat4 view = camera.GetViewMatrix();
-        terrainShader.setMat4("projection", projection);
-        terrainShader.setMat4("view", view);
 
-        // World transformation
-        glm::mat4 model = glm::mat4(1.0f);
-        terrainShader.setMat4("model", model);
+        // Stream terrain chunks around the camera and cull them to the view
+        terrain.update(camera.Position, projection * view);
+        // Scatter props over newly arrived terrain and cull them to the view
+        props.update(terrain, camera.Position, projection * view);
 
-        // Lighting
-        terrainShader.setVec3("lightPos", lightPos);
-        terrainShader.setVec3("viewPos", camera.Position);
-        terrainShader.setFloat("lightIntensity", lightIntensity); // Pass light intensity to shader
+        // Camera and sun, at most once a second (with --verbose)
+        LOG_LIMITED(LOG_DEBUG, positionLog) << "Camera position: " << camera.Position.x << ", " << camera.Position.y
+            << ", " << camera.Position.z << "; sun position: " << lightPos.x << ", " << lightPos.y << ", " << lightPos.z;
 
+        profiler.end(PROFILE_UPDATE);
 
-        // Render terrain
-        terrain.Draw(terrainShader);
-
-        // Render the sun (sphere)
-        lightShader.use();
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, lightPos); // Position sun at the light source
-        lightShader.setMat4("model", model);
-        lightShader.setMat4("view", view);
-        lightShader.setMat4("projection", projection);
-        sun.Draw(lightShader.ID);
+        // Render
+        renderScene(terrain, props, terrainShader, propShader, lightShader, sun, frameUniforms, projection, view,
+            profiler);
+        {
+            // Overlays, then all of the frame's text in a single draw call
+            ProfileScope scope(profiler, PROFILE_OVERLAY);
+            int width, height;
+            glfwGetFramebufferSize(window, &width, &height);
+            if (showProfiler)
+                overlay.draw(profiler, width, height);
+            text.draw(width, height);
+        }
 
         // Swap buffers and poll events
+        profiler.begin(PROFILE_SWAP);
         glfwSwapBuffers(window);
         glfwPollEvents();
+        profiler.end(PROFILE_SWAP);
+        profiler.endFrame();
     }
 
+    profiler.finish();
+    if (!tracePath.empty() && !profiler.writeTrace(tracePath))
+        LOG(LOG_ERROR) << "Could not write the trace to " << tracePath;
+
     // Optional: de-allocate all resources
     glfwTerminate();
     return 0;
 }
 
+// Creates the window with an OpenGL 3.3 core context. Offscreen windows are
+// hidden; with no display at all (e.g. a CI machine without a GPU) they fall
+// back to GLFW's null platform with an OSMesa (llvmpipe) context.
+GLFWwindow* createWindow(bool offscreen) {
+    if (glfwInit()) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, offscreen ? GLFW_FALSE : GLFW_TRUE);
+
+        GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Fantasy Landscape", NULL, NULL);
+        if (window != NULL || !offscreen)
+            return window;
+        glfwTerminate();
+    }
+
+#ifdef GLFW_PLATFORM_NULL // GLFW 3.4
+    if (offscreen) {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+        if (glfwInit()) {
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+            return glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Fantasy Landscape", NULL, NULL);
+        }
+    }
+#endif
+    return NULL;
+}
+
+// Draws the sky, terrain, props and sun for one frame
+void renderScene(ChunkManager& terrain, PropRenderer& props, Shader& terrainShader, Shader& propShader,
+    Shader& lightShader, Sphere& sun, FrameUniforms& frameUniforms, const glm::mat4& projection,
+    const glm::mat4& view, Profiler& profiler) {
+    glm::vec3 skyboxColor = getSkyboxColor(timeOfDay);
+
+    glClearColor(skyboxColor.r, skyboxColor.g, skyboxColor.b, 1.0f); // Use skybox color
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Camera and lighting for every program in one buffer update
+    frameUniforms.update(view, projection, lightPos, lightIntensity, camera.Position);
+
+    // Render terrain
+    profiler.begin(PROFILE_TERRAIN_DRAW);
+    terrainShader.use();
+    terrain.Draw(terrainShader);
+    profiler.end(PROFILE_TERRAIN_DRAW);
+
+    // Render the props, one instanced draw per type
+    profiler.begin(PROFILE_PROPS_DRAW);
+    props.Draw(propShader);
+    profiler.end(PROFILE_PROPS_DRAW);
+
+    // Render the sun (sphere)
+    ProfileScope scope(profiler, PROFILE_SUN_DRAW);
+    lightShader.use();
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, lightPos); // Position sun at the light source
+    lightShader.setMat4("model", model);
+    sun.Draw(lightShader.ID);
+}
+
+// Flies the camera along CameraPath::flyover() for benchmarkFrames frames with
+// a fixed time step, then prints the timings as JSON
+int runBenchmark(GLFWwindow* window, ChunkManager& terrain, PropRenderer& props, ShaderManager& shaders,
+    Shader& terrainShader, Shader& propShader, Shader& lightShader, Sphere& sun, FrameUniforms& frameUniforms) {
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::duration<double, std::milli> Milliseconds;
+
+    CameraPath path = CameraPath::flyover();
+    deltaTime = 1.0f / 60.0f;
+    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
+        (float)SCR_WIDTH / (float)SCR_HEIGHT,
+        1.0f, terrain.viewDistance());
+
+    // Stream in all of the terrain around the start first (the shaders
+    // compile meanwhile), so every run begins from the same state
+    camera.Position = path.position(0.0f);
+    camera.LookAlong(path.direction(0.0f));
+    do {
+        terrain.update(camera.Position, projection * camera.GetViewMatrix());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } while (terrain.pendingChunks() > 0);
+    shaders.finishAll();
+
+    GpuTimer gpuTimer;
+    // Phase timings only for --trace; its GPU queries are left out otherwise
+    Profiler profiler(!tracePath.empty());
+    profiler.setRecording(!tracePath.empty());
+    std::vector<BenchmarkFrame> frames;
+    frames.reserve(benchmarkFrames);
+    Clock::time_point frameStart = Clock::now();
+    for (int i = 0; i < benchmarkFrames; ++i) {
+        profiler.beginFrame();
+        profiler.begin(PROFILE_UPDATE);
+        float t = static_cast<float>(i) / benchmarkFrames;
+        camera.Position = path.position(t);
+        camera.LookAlong(path.direction(t));
+        updateSunPosition();
+        updateLightPosition();
+
+        gpuTimer.beginFrame();
+        glm::mat4 view = camera.GetViewMatrix();
+        terrain.update(camera.Position, projection * view);
+        props.update(terrain, camera.Position, projection * view);
+        profiler.end(PROFILE_UPDATE);
+        renderScene(terrain, props, terrainShader, propShader, lightShader, sun, frameUniforms, projection, view,
+            profiler);
+        Clock::time_point submitted = Clock::now();
+
+        profiler.begin(PROFILE_SWAP);
+        glfwSwapBuffers(window);
+        gpuTimer.endFrame();
+        glfwPollEvents();
+        profiler.end(PROFILE_SWAP);
+        profiler.endFrame();
+        Clock::time_point frameEnd = Clock::now();
+
+        BenchmarkFrame frame;
+        frame.cpuMs = Milliseconds(submitted - frameStart).count();
+        frame.frameMs = Milliseconds(frameEnd - frameStart).count();
+        frame.gpuMs = 0.0;
+        frame.chunksDrawn = terrain.chunksDrawn();
+        frame.pendingChunks = terrain.pendingChunks();
+        frame.propsDrawn = props.drawnProps();
+        frames.push_back(frame);
+        frameStart = frameEnd;
+    }
+
+    gpuTimer.finish();
+    GpuTimer::Frame gpuFrame;
+    for (size_t i = 0; i < frames.size() && gpuTimer.takeFrame(gpuFrame); ++i)
+        frames[i].gpuMs = gpuFrame.ms;
+    profiler.finish();
+    if (!tracePath.empty() && !profiler.writeTrace(tracePath))
+        LOG(LOG_ERROR) << "Could not write the trace to " << tracePath;
+
+    const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    writeBenchmarkJson(std::cout, frames, renderer ? renderer : "",
+        TERRAIN_VERTEX_FORMAT_NAMES[terrain.getVertexFormat()], SCR_WIDTH, SCR_HEIGHT);
+    return 0;
+}
+
 // Process input function
 void processInput(GLFWwindow* window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    // Toggle the profiler overlay once per press
+    bool profilerKey = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+    if (profilerKey && !profilerKeyDown)
+        showProfiler = !showProfiler;
+    profilerKeyDown = profilerKey;
+
     // Camera movement
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
         camera.ProcessKeyboard(FORWARD, deltaTime);
@@ -185,6 +466,36 @@ void processInput(GLFWwindow* window) {
 		camera.ProcessKeyboard(SPRINT, deltaTime);
 }
 
+// Terrain editing where the camera looks: R raises, F lowers, T smooths
+void editTerrain(GLFWwindow* window, ChunkManager& terrain, PropRenderer& props) {
+    TerrainBrush brush;
+    brush.radius = 60.0f;
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+        brush.mode = TERRAIN_BRUSH_RAISE;
+        brush.strength = 100.0f * deltaTime;
+    }
+    else if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS) {
+        brush.mode = TERRAIN_BRUSH_LOWER;
+        brush.strength = 100.0f * deltaTime;
+    }
+    else if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS) {
+        brush.mode = TERRAIN_BRUSH_SMOOTH;
+        brush.strength = std::min(5.0f * deltaTime, 1.0f);
+    }
+    else {
+        return;
+    }
+
+    glm::vec3 target;
+    if (!terrain.raycast(camera.Position, camera.Front, terrain.viewDistance(), target))
+        return;
+    brush.x = target.x;
+    brush.z = target.z;
+    terrain.edit(brush);
+    // Stand the props there on the new ground
+    props.invalidate(brush.x, brush.z, brush.radius);
+}
+
 // GLFW callback functions
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
@@ -0,0 +1,55 @@
+#ifndef NOISE_CONTEXT_H
+#define NOISE_CONTEXT_H
+
+#include <cstdint>
+#include <random>
+
+// Permutation table for perlin_noise and friends, built from an explicit seed.
+// The same seed gives the same table (and so the same landscape) on every run
+// and every platform: the shuffle is spelled out below rather than left to
+// std::shuffle, whose algorithm differs between standard libraries.
+//
+// The 256 entries are stored twice so lookups of p[i + 1] need no wrap, as
+// bytes, so the whole table is 8 cache lines instead of the 32 a vector<int>
+// takes. The AVX2 path gathers 32-bit words at byte offsets and masks off the
+// low byte, which reads up to three bytes past entry 511; GatherPadding
+// covers that.
+//
+// A context is immutable after construction, so one instance can be shared
+// by any number of threads.
+class NoiseContext {
+public:
+    static const int Size = 512;
+    static const int GatherPadding = 4;
+
+    explicit NoiseContext(unsigned int seed) : seedValue(seed) {
+        for (int i = 0; i < 256; ++i)
+            table[i] = static_cast<std::uint8_t>(i);
+
+        // Fisher-Yates with the raw output of mt19937, which (unlike the
+        // standard distributions) is the same everywhere
+        std::mt19937 generator(seed);
+        for (int i = 255; i > 0; --i) {
+            int j = static_cast<int>(generator() % static_cast<unsigned int>(i + 1));
+            std::uint8_t t = table[i];
+            table[i] = table[j];
+            table[j] = t;
+        }
+
+        for (int i = 0; i < 256; ++i)
+            table[256 + i] = table[i];
+        for (int i = 0; i < GatherPadding; ++i)
+            table[Size + i] = 0;
+    }
+
+    unsigned int seed() const { return seedValue; }
+
+    int operator[](int i) const { return table[i]; }
+    const std::uint8_t* data() const { return table; }
+
+private:
+    unsigned int seedValue;
+    alignas(64) std::uint8_t table[Size + GatherPadding];
+};
+
+#endif // NOISE_CONTEXT_H
@@ -0,0 +1,57 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Number of worker threads to use for CPU-side generation work
+inline int workerCount() {
+    unsigned int hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1 : static_cast<int>(hw);
+}
+
+// Set to true on threads that are themselves one of several workers (e.g. chunk
+// generators) so parallelFor calls made from them run inline rather than
+// oversubscribing the machine
+inline bool& isWorkerThread() {
+    thread_local bool worker = false;
+    return worker;
+}
+
+// Split [begin, end) into contiguous bands and run fn(bandBegin, bandEnd) for
+// each band on its own thread. The calling thread processes the last band and
+// the call returns once every band is done. Each index belongs to exactly one
+// band, so as long as fn only writes the outputs of its own indices the result
+// is identical to a single-threaded loop.
+template <typename Fn>
+void parallelFor(int begin, int end, Fn fn, int minBand = 16) {
+    int count = end - begin;
+    if (count <= 0)
+        return;
+
+    int bands = std::min(workerCount(), (count + minBand - 1) / minBand);
+    if (bands <= 1 || isWorkerThread()) {
+        fn(begin, end);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(bands - 1);
+    int bandSize = count / bands;
+    int remainder = count % bands;
+    int bandBegin = begin;
+    for (int b = 0; b < bands; ++b) {
+        int bandEnd = bandBegin + bandSize + (b < remainder ? 1 : 0);
+        if (b == bands - 1)
+            fn(bandBegin, bandEnd);
+        else
+            threads.emplace_back(fn, bandBegin, bandEnd);
+        bandBegin = bandEnd;
+    }
+
+    for (std::thread& t : threads)
+        t.join();
+}
+
+#endif // PARALLEL_H
@@ -1,20 +1,38 @@
+#ifndef PERLIN_H
+#define PERLIN_H
+
 #include <vector>
-#include <numeric> // For std::iota
+#include <cmath>
 #include <algorithm> // For std::shuffle
-#include <random> // For std::random_device and std::mt19937
+#include "noise_context.h"
+
+// SIMD paths the compiler was told it may use; the batch functions take the
+// widest. Build with /arch:AVX2 (MSVC) or -mavx2 (GCC/Clang) for 8 lanes; SSE2
+// is the x64 baseline and is compiled alongside AVX2 too, so both kernels can
+// be checked in one build. Define PERLIN_NO_SIMD to force the scalar path.
+#if !defined(PERLIN_NO_SIMD)
+#if defined(__AVX2__)
+#define PERLIN_SIMD_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PERLIN_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#endif
 
-double fade(double t) { return t * t * t * (t * (t * 6 - 15) + 10); };
+inline double fade(double t) { return t * t * t * (t * (t * 6 - 15) + 10); };
 
-double lerp(double t, double a, double b) { return a + t * (b - a); }
+inline double lerp(double t, double a, double b) { return a + t * (b - a); }
 
-double grad(int hash, double x, double y, double z) {
+inline double grad(int hash, double x, double y, double z) {
     int h = hash & 15;                      // CONVERT LO 4 BITS OF HASH CODE
     double u = h < 8 ? x : y,                 // INTO 12 GRADIENT DIRECTIONS.
         v = h < 4 ? y : h == 12 || h == 14 ? x : z;
     return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
 }
 
-double perlin_noise(double x, double y, double z, std::vector<int>& p) {
+inline double perlin_noise(double x, double y, double z, const NoiseContext& p) {
     int X = (int)floor(x) & 255;                  // FIND UNIT CUBE THAT
     int Y = (int)floor(y) & 255;                  // CONTAINS POINT.
     int Z = (int)floor(z) & 255;
@@ -37,6 +55,47 @@ double perlin_noise(double x, double y, double z, std::vector<int>& p) {
                 grad(p[BB + 1], x - 1, y - 1, z - 1))));
 }
 
+inline double fade_derivative(double t) { return 30 * t * t * (t * (t - 2) + 1); }
+
+// Perlin noise together with its partial derivatives along x and y, from the
+// same lattice lookups. Each corner contributes dot(g, offset), so the
+// derivative is the blended corner gradients g plus the fade curves' slope
+// times the difference between the corners they blend.
+inline double perlin_noise_deriv(double x, double y, double z, const NoiseContext& p, double& dx, double& dy) {
+    int X = (int)floor(x) & 255;
+    int Y = (int)floor(y) & 255;
+    int Z = (int)floor(z) & 255;
+    x -= floor(x);
+    y -= floor(y);
+    z -= floor(z);
+    double u = fade(x);
+    double v = fade(y);
+    double w = fade(z);
+    int A = p[X] + Y, AA = p[A] + Z, AB = p[A + 1] + Z,
+        B = p[X + 1] + Y, BA = p[B] + Z, BB = p[B + 1] + Z;
+    int h[8] = { p[AA], p[BA], p[AB], p[BB], p[AA + 1], p[BA + 1], p[AB + 1], p[BB + 1] };
+
+    // Corner values, and the corner gradients' x and y components (grad is
+    // linear in the offset, so these are grad with a unit offset)
+    double g000 = grad(h[0], x, y, z), g100 = grad(h[1], x - 1, y, z),
+        g010 = grad(h[2], x, y - 1, z), g110 = grad(h[3], x - 1, y - 1, z),
+        g001 = grad(h[4], x, y, z - 1), g101 = grad(h[5], x - 1, y, z - 1),
+        g011 = grad(h[6], x, y - 1, z - 1), g111 = grad(h[7], x - 1, y - 1, z - 1);
+    auto blend = [&](int axis) {
+        double c[8];
+        for (int i = 0; i < 8; ++i)
+            c[i] = axis == 0 ? grad(h[i], 1, 0, 0) : grad(h[i], 0, 1, 0);
+        return lerp(w, lerp(v, lerp(u, c[0], c[1]), lerp(u, c[2], c[3])),
+            lerp(v, lerp(u, c[4], c[5]), lerp(u, c[6], c[7])));
+    };
+
+    double x0 = lerp(u, g000, g100), x1 = lerp(u, g010, g110),
+        x2 = lerp(u, g001, g101), x3 = lerp(u, g011, g111);
+    dx = blend(0) + fade_derivative(x) * lerp(w, lerp(v, g100 - g000, g110 - g010), lerp(v, g101 - g001, g111 - g011));
+    dy = blend(1) + fade_derivative(y) * lerp(w, x1 - x0, x3 - x2);
+    return lerp(w, lerp(v, x0, x1), lerp(v, x2, x3));
+}
+
 //std::vector<int> get_permutation_vector() {
 //    std::vector<int> p;
 //
@@ -63,21 +122,436 @@ double perlin_noise(double x, double y, double z, std::vector<int>& p) {
 //    return p;
 //}
 
-#include <random>
+// ---------------------------------------------------------------------------
+// Batch evaluation
+//
+// perlin_noise_batch evaluates count samples at (xs[i], ys[i], z) in single
+// precision, 8 (AVX2) or 4 (SSE2) lanes at a time. It follows the exact same
+// hashing and gradient selection as perlin_noise, so results only differ from
+// the scalar double path by float rounding: under 2e-6 for values and 8e-6
+// for derivatives over the sample ranges the terrain uses, which NoiseTests
+// checks for every kernel.
+// ---------------------------------------------------------------------------
+
+#if defined(PERLIN_SIMD_AVX2)
+
+inline __m256 perlin_fade8(__m256 t) {
+    __m256 k = _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f));
+    k = _mm256_add_ps(_mm256_mul_ps(t, k), _mm256_set1_ps(10.0f));
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), k);
+}
+
+inline __m256 perlin_lerp8(__m256 t, __m256 a, __m256 b) {
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+inline __m256 perlin_grad8(__m256i hash, __m256 x, __m256 y, __m256 z) {
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+    // u = h < 8 ? x : y
+    __m256 hLt8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    __m256 u = _mm256_blendv_ps(y, x, hLt8);
+    // v = h < 4 ? y : h == 12 || h == 14 ? x : z
+    __m256 hLt4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    __m256 h12or14 = _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)),
+        _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))));
+    __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, h12or14), y, hLt4);
+    // Flip signs with bits 0 and 1 of the hash
+    __m256 uSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+    __m256 vSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+    return _mm256_add_ps(_mm256_xor_ps(u, uSign), _mm256_xor_ps(v, vSign));
+}
+
+// Gathers the 32-bit words starting at each byte and keeps their low byte
+// (see NoiseContext::GatherPadding)
+inline __m256i perlin_gather8(const std::uint8_t* p, __m256i idx) {
+    __m256i words = _mm256_i32gather_epi32(reinterpret_cast<const int*>(p), idx, 1);
+    return _mm256_and_si256(words, _mm256_set1_epi32(0xff));
+}
+
+// Moves (x, y, z) to its position within its lattice cell and looks up the
+// hashes of the cell's corners, ordered 000, 100, 010, 110, 001, 101, 011, 111
+inline void perlin_corners8(__m256& x, __m256& y, __m256& z, const std::uint8_t* p, __m256i h[8]) {
+    __m256 fx = _mm256_floor_ps(x);
+    __m256 fy = _mm256_floor_ps(y);
+    __m256 fz = _mm256_floor_ps(z);
+    __m256i mask = _mm256_set1_epi32(255);
+    __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask);
+    __m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+    __m256i Z = _mm256_and_si256(_mm256_cvttps_epi32(fz), mask);
+    x = _mm256_sub_ps(x, fx);
+    y = _mm256_sub_ps(y, fy);
+    z = _mm256_sub_ps(z, fz);
+
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i A = _mm256_add_epi32(perlin_gather8(p, X), Y);
+    __m256i AA = _mm256_add_epi32(perlin_gather8(p, A), Z);
+    __m256i AB = _mm256_add_epi32(perlin_gather8(p, _mm256_add_epi32(A, one)), Z);
+    __m256i B = _mm256_add_epi32(perlin_gather8(p, _mm256_add_epi32(X, one)), Y);
+    __m256i BA = _mm256_add_epi32(perlin_gather8(p, B), Z);
+    __m256i BB = _mm256_add_epi32(perlin_gather8(p, _mm256_add_epi32(B, one)), Z);
+
+    h[0] = perlin_gather8(p, AA);
+    h[1] = perlin_gather8(p, BA);
+    h[2] = perlin_gather8(p, AB);
+    h[3] = perlin_gather8(p, BB);
+    h[4] = perlin_gather8(p, _mm256_add_epi32(AA, one));
+    h[5] = perlin_gather8(p, _mm256_add_epi32(BA, one));
+    h[6] = perlin_gather8(p, _mm256_add_epi32(AB, one));
+    h[7] = perlin_gather8(p, _mm256_add_epi32(BB, one));
+}
+
+// Trilinear blend of per-corner values c (same corner order)
+inline __m256 perlin_blend8(__m256 u, __m256 v, __m256 w, const __m256 c[8]) {
+    return perlin_lerp8(w,
+        perlin_lerp8(v, perlin_lerp8(u, c[0], c[1]), perlin_lerp8(u, c[2], c[3])),
+        perlin_lerp8(v, perlin_lerp8(u, c[4], c[5]), perlin_lerp8(u, c[6], c[7])));
+}
+
+// Dot products of the corner gradients with the offsets to (x, y, z)
+inline void perlin_corner_values8(const __m256i h[8], __m256 x, __m256 y, __m256 z, __m256 g[8]) {
+    __m256 c1 = _mm256_set1_ps(1.0f);
+    __m256 x1 = _mm256_sub_ps(x, c1);
+    __m256 y1 = _mm256_sub_ps(y, c1);
+    __m256 z1 = _mm256_sub_ps(z, c1);
+    g[0] = perlin_grad8(h[0], x, y, z);
+    g[1] = perlin_grad8(h[1], x1, y, z);
+    g[2] = perlin_grad8(h[2], x, y1, z);
+    g[3] = perlin_grad8(h[3], x1, y1, z);
+    g[4] = perlin_grad8(h[4], x, y, z1);
+    g[5] = perlin_grad8(h[5], x1, y, z1);
+    g[6] = perlin_grad8(h[6], x, y1, z1);
+    g[7] = perlin_grad8(h[7], x1, y1, z1);
+}
+
+inline __m256 perlin_noise8(__m256 x, __m256 y, __m256 z, const std::uint8_t* p) {
+    __m256i h[8];
+    perlin_corners8(x, y, z, p, h);
+    __m256 g[8];
+    perlin_corner_values8(h, x, y, z, g);
+    return perlin_blend8(perlin_fade8(x), perlin_fade8(y), perlin_fade8(z), g);
+}
+
+inline __m256 perlin_fade_derivative8(__m256 t) {
+    // 30 t^2 (t (t - 2) + 1)
+    __m256 k = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(t, _mm256_set1_ps(2.0f))), _mm256_set1_ps(1.0f));
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(30.0f), _mm256_mul_ps(t, t)), k);
+}
+
+// perlin_noise_deriv for 8 samples
+inline __m256 perlin_noise_deriv8(__m256 x, __m256 y, __m256 z, const std::uint8_t* p, __m256& dx, __m256& dy) {
+    __m256i h[8];
+    perlin_corners8(x, y, z, p, h);
+    __m256 g[8];
+    perlin_corner_values8(h, x, y, z, g);
+    __m256 u = perlin_fade8(x);
+    __m256 v = perlin_fade8(y);
+    __m256 w = perlin_fade8(z);
+
+    __m256 one = _mm256_set1_ps(1.0f), zero = _mm256_setzero_ps();
+    __m256 gx[8], gy[8];
+    for (int i = 0; i < 8; ++i) {
+        gx[i] = perlin_grad8(h[i], one, zero, zero);
+        gy[i] = perlin_grad8(h[i], zero, one, zero);
+    }
+
+    __m256 x0 = perlin_lerp8(u, g[0], g[1]), x1 = perlin_lerp8(u, g[2], g[3]);
+    __m256 x2 = perlin_lerp8(u, g[4], g[5]), x3 = perlin_lerp8(u, g[6], g[7]);
+    __m256 slopeX = perlin_lerp8(w,
+        perlin_lerp8(v, _mm256_sub_ps(g[1], g[0]), _mm256_sub_ps(g[3], g[2])),
+        perlin_lerp8(v, _mm256_sub_ps(g[5], g[4]), _mm256_sub_ps(g[7], g[6])));
+    __m256 slopeY = perlin_lerp8(w, _mm256_sub_ps(x1, x0), _mm256_sub_ps(x3, x2));
+    dx = _mm256_add_ps(perlin_blend8(u, v, w, gx), _mm256_mul_ps(perlin_fade_derivative8(x), slopeX));
+    dy = _mm256_add_ps(perlin_blend8(u, v, w, gy), _mm256_mul_ps(perlin_fade_derivative8(y), slopeY));
+    return perlin_lerp8(w, perlin_lerp8(v, x0, x1), perlin_lerp8(v, x2, x3));
+}
+
+#endif
+
+#if defined(PERLIN_SIMD_SSE2)
+
+inline __m128 perlin_select4(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); // mask ? a : b
+}
+
+inline __m128 perlin_fade4(__m128 t) {
+    __m128 k = _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f));
+    k = _mm_add_ps(_mm_mul_ps(t, k), _mm_set1_ps(10.0f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), k);
+}
+
+inline __m128 perlin_lerp4(__m128 t, __m128 a, __m128 b) {
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
 
-std::vector<int> get_permutation_vector() {
-    std::vector<int> p(256);
-    std::iota(p.begin(), p.end(), 0); // Fill p with values from 0 to 255
+// SSE2 has no floor instruction: truncate, then step down where that rounded up
+inline __m128i perlin_floor4(__m128 x, __m128& floored) {
+    __m128i t = _mm_cvttps_epi32(x);
+    __m128 tf = _mm_cvtepi32_ps(t);
+    __m128 roundedUp = _mm_cmpgt_ps(tf, x);
+    t = _mm_add_epi32(t, _mm_castps_si128(roundedUp)); // mask lanes are -1
+    floored = _mm_cvtepi32_ps(t);
+    return t;
+}
 
-    // Create a random device and seed the random engine
-    std::random_device rd;
-    std::mt19937 generator(rd());
+inline __m128 perlin_grad4(__m128i hash, __m128 x, __m128 y, __m128 z) {
+    __m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+    // u = h < 8 ? x : y
+    __m128 u = perlin_select4(_mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8))), x, y);
+    // v = h < 4 ? y : h == 12 || h == 14 ? x : z
+    __m128 h12or14 = _mm_castsi128_ps(_mm_or_si128(
+        _mm_cmpeq_epi32(h, _mm_set1_epi32(12)),
+        _mm_cmpeq_epi32(h, _mm_set1_epi32(14))));
+    __m128 v = perlin_select4(_mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4))), y,
+        perlin_select4(h12or14, x, z));
+    // Flip signs with bits 0 and 1 of the hash
+    __m128 uSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31));
+    __m128 vSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30));
+    return _mm_add_ps(_mm_xor_ps(u, uSign), _mm_xor_ps(v, vSign));
+}
 
-    // Shuffle the permutation vector with the random engine
-    std::shuffle(p.begin(), p.end(), generator);
+// SSE2 has no gather either, so look the lanes up one by one
+inline __m128i perlin_gather4(const std::uint8_t* p, __m128i idx) {
+    alignas(16) int lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), idx);
+    return _mm_setr_epi32(p[lanes[0]], p[lanes[1]], p[lanes[2]], p[lanes[3]]);
+}
 
-    // Duplicate the permutation vector
-    p.insert(p.end(), p.begin(), p.end());
+// Moves (x, y, z) to its position within its lattice cell and looks up the
+// hashes of the cell's corners, ordered 000, 100, 010, 110, 001, 101, 011, 111
+inline void perlin_corners4(__m128& x, __m128& y, __m128& z, const std::uint8_t* p, __m128i h[8]) {
+    __m128 fx, fy, fz;
+    __m128i mask = _mm_set1_epi32(255);
+    __m128i X = _mm_and_si128(perlin_floor4(x, fx), mask);
+    __m128i Y = _mm_and_si128(perlin_floor4(y, fy), mask);
+    __m128i Z = _mm_and_si128(perlin_floor4(z, fz), mask);
+    x = _mm_sub_ps(x, fx);
+    y = _mm_sub_ps(y, fy);
+    z = _mm_sub_ps(z, fz);
+
+    __m128i one = _mm_set1_epi32(1);
+    __m128i A = _mm_add_epi32(perlin_gather4(p, X), Y);
+    __m128i AA = _mm_add_epi32(perlin_gather4(p, A), Z);
+    __m128i AB = _mm_add_epi32(perlin_gather4(p, _mm_add_epi32(A, one)), Z);
+    __m128i B = _mm_add_epi32(perlin_gather4(p, _mm_add_epi32(X, one)), Y);
+    __m128i BA = _mm_add_epi32(perlin_gather4(p, B), Z);
+    __m128i BB = _mm_add_epi32(perlin_gather4(p, _mm_add_epi32(B, one)), Z);
+
+    h[0] = perlin_gather4(p, AA);
+    h[1] = perlin_gather4(p, BA);
+    h[2] = perlin_gather4(p, AB);
+    h[3] = perlin_gather4(p, BB);
+    h[4] = perlin_gather4(p, _mm_add_epi32(AA, one));
+    h[5] = perlin_gather4(p, _mm_add_epi32(BA, one));
+    h[6] = perlin_gather4(p, _mm_add_epi32(AB, one));
+    h[7] = perlin_gather4(p, _mm_add_epi32(BB, one));
+}
+
+// Trilinear blend of per-corner values c (same corner order)
+inline __m128 perlin_blend4(__m128 u, __m128 v, __m128 w, const __m128 c[8]) {
+    return perlin_lerp4(w,
+        perlin_lerp4(v, perlin_lerp4(u, c[0], c[1]), perlin_lerp4(u, c[2], c[3])),
+        perlin_lerp4(v, perlin_lerp4(u, c[4], c[5]), perlin_lerp4(u, c[6], c[7])));
+}
+
+// Dot products of the corner gradients with the offsets to (x, y, z)
+inline void perlin_corner_values4(const __m128i h[8], __m128 x, __m128 y, __m128 z, __m128 g[8]) {
+    __m128 c1 = _mm_set1_ps(1.0f);
+    __m128 x1 = _mm_sub_ps(x, c1);
+    __m128 y1 = _mm_sub_ps(y, c1);
+    __m128 z1 = _mm_sub_ps(z, c1);
+    g[0] = perlin_grad4(h[0], x, y, z);
+    g[1] = perlin_grad4(h[1], x1, y, z);
+    g[2] = perlin_grad4(h[2], x, y1, z);
+    g[3] = perlin_grad4(h[3], x1, y1, z);
+    g[4] = perlin_grad4(h[4], x, y, z1);
+    g[5] = perlin_grad4(h[5], x1, y, z1);
+    g[6] = perlin_grad4(h[6], x, y1, z1);
+    g[7] = perlin_grad4(h[7], x1, y1, z1);
+}
+
+inline __m128 perlin_noise4(__m128 x, __m128 y, __m128 z, const std::uint8_t* p) {
+    __m128i h[8];
+    perlin_corners4(x, y, z, p, h);
+    __m128 g[8];
+    perlin_corner_values4(h, x, y, z, g);
+    return perlin_blend4(perlin_fade4(x), perlin_fade4(y), perlin_fade4(z), g);
+}
+
+inline __m128 perlin_fade_derivative4(__m128 t) {
+    // 30 t^2 (t (t - 2) + 1)
+    __m128 k = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(t, _mm_set1_ps(2.0f))), _mm_set1_ps(1.0f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(30.0f), _mm_mul_ps(t, t)), k);
+}
+
+// perlin_noise_deriv for 4 samples
+inline __m128 perlin_noise_deriv4(__m128 x, __m128 y, __m128 z, const std::uint8_t* p, __m128& dx, __m128& dy) {
+    __m128i h[8];
+    perlin_corners4(x, y, z, p, h);
+    __m128 g[8];
+    perlin_corner_values4(h, x, y, z, g);
+    __m128 u = perlin_fade4(x);
+    __m128 v = perlin_fade4(y);
+    __m128 w = perlin_fade4(z);
+
+    __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+    __m128 gx[8], gy[8];
+    for (int i = 0; i < 8; ++i) {
+        gx[i] = perlin_grad4(h[i], one, zero, zero);
+        gy[i] = perlin_grad4(h[i], zero, one, zero);
+    }
+
+    __m128 x0 = perlin_lerp4(u, g[0], g[1]), x1 = perlin_lerp4(u, g[2], g[3]);
+    __m128 x2 = perlin_lerp4(u, g[4], g[5]), x3 = perlin_lerp4(u, g[6], g[7]);
+    __m128 slopeX = perlin_lerp4(w,
+        perlin_lerp4(v, _mm_sub_ps(g[1], g[0]), _mm_sub_ps(g[3], g[2])),
+        perlin_lerp4(v, _mm_sub_ps(g[5], g[4]), _mm_sub_ps(g[7], g[6])));
+    __m128 slopeY = perlin_lerp4(w, _mm_sub_ps(x1, x0), _mm_sub_ps(x3, x2));
+    dx = _mm_add_ps(perlin_blend4(u, v, w, gx), _mm_mul_ps(perlin_fade_derivative4(x), slopeX));
+    dy = _mm_add_ps(perlin_blend4(u, v, w, gy), _mm_mul_ps(perlin_fade_derivative4(y), slopeY));
+    return perlin_lerp4(w, perlin_lerp4(v, x0, x1), perlin_lerp4(v, x2, x3));
+}
+
+#endif
+
+// Evaluate count samples at (xs[i], ys[i], z) into out[i], with the widest
+// kernel the build has. A sample's value does not depend on where it sits in
+// the batch (the tail is padded out to a full SIMD block), so terrains that
+// share an edge get identical heights there.
+//
+// The per-width versions below are what it dispatches to; they are public so
+// each kernel can be checked against perlin_noise (NoiseTests).
+
+#if defined(PERLIN_SIMD_AVX2)
+inline void perlin_noise_batch_avx2(const float* xs, const float* ys, float z, float* out, int count,
+    const NoiseContext& p) {
+    int i = 0;
+    __m256 zv = _mm256_set1_ps(z);
+    for (; i + 8 <= count; i += 8) {
+        __m256 n = perlin_noise8(_mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i), zv, p.data());
+        _mm256_storeu_ps(out + i, n);
+    }
+    if (i < count) {
+        alignas(32) float tailX[8] = {}, tailY[8] = {}, tailOut[8];
+        std::copy(xs + i, xs + count, tailX);
+        std::copy(ys + i, ys + count, tailY);
+        _mm256_store_ps(tailOut, perlin_noise8(_mm256_load_ps(tailX), _mm256_load_ps(tailY), zv, p.data()));
+        std::copy(tailOut, tailOut + (count - i), out + i);
+    }
+}
+#endif
+
+#if defined(PERLIN_SIMD_SSE2)
+inline void perlin_noise_batch_sse2(const float* xs, const float* ys, float z, float* out, int count,
+    const NoiseContext& p) {
+    int i = 0;
+    __m128 zv = _mm_set1_ps(z);
+    for (; i + 4 <= count; i += 4) {
+        __m128 n = perlin_noise4(_mm_loadu_ps(xs + i), _mm_loadu_ps(ys + i), zv, p.data());
+        _mm_storeu_ps(out + i, n);
+    }
+    if (i < count) {
+        alignas(16) float tailX[4] = {}, tailY[4] = {}, tailOut[4];
+        std::copy(xs + i, xs + count, tailX);
+        std::copy(ys + i, ys + count, tailY);
+        _mm_store_ps(tailOut, perlin_noise4(_mm_load_ps(tailX), _mm_load_ps(tailY), zv, p.data()));
+        std::copy(tailOut, tailOut + (count - i), out + i);
+    }
+}
+#endif
+
+// Scalar fallback for builds without SIMD
+inline void perlin_noise_batch_scalar(const float* xs, const float* ys, float z, float* out, int count,
+    const NoiseContext& p) {
+    for (int i = 0; i < count; ++i)
+        out[i] = static_cast<float>(perlin_noise(xs[i], ys[i], z, p));
+}
+
+inline void perlin_noise_batch(const float* xs, const float* ys, float z, float* out, int count,
+    const NoiseContext& p) {
+#if defined(PERLIN_SIMD_AVX2)
+    perlin_noise_batch_avx2(xs, ys, z, out, count, p);
+#elif defined(PERLIN_SIMD_SSE2)
+    perlin_noise_batch_sse2(xs, ys, z, out, count, p);
+#else
+    perlin_noise_batch_scalar(xs, ys, z, out, count, p);
+#endif
+}
+
+// perlin_noise_batch that also writes the noise's partial derivatives along
+// x and y to dx[i] and dy[i]. out[i] is identical to perlin_noise_batch's.
+
+#if defined(PERLIN_SIMD_AVX2)
+inline void perlin_noise_batch_deriv_avx2(const float* xs, const float* ys, float z, float* out,
+    float* dx, float* dy, int count, const NoiseContext& p) {
+    int i = 0;
+    __m256 zv = _mm256_set1_ps(z);
+    __m256 ddx, ddy;
+    for (; i + 8 <= count; i += 8) {
+        __m256 n = perlin_noise_deriv8(_mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i), zv, p.data(), ddx, ddy);
+        _mm256_storeu_ps(out + i, n);
+        _mm256_storeu_ps(dx + i, ddx);
+        _mm256_storeu_ps(dy + i, ddy);
+    }
+    if (i < count) {
+        alignas(32) float tailX[8] = {}, tailY[8] = {}, tailOut[8], tailDx[8], tailDy[8];
+        std::copy(xs + i, xs + count, tailX);
+        std::copy(ys + i, ys + count, tailY);
+        _mm256_store_ps(tailOut, perlin_noise_deriv8(_mm256_load_ps(tailX), _mm256_load_ps(tailY), zv, p.data(), ddx, ddy));
+        _mm256_store_ps(tailDx, ddx);
+        _mm256_store_ps(tailDy, ddy);
+        std::copy(tailOut, tailOut + (count - i), out + i);
+        std::copy(tailDx, tailDx + (count - i), dx + i);
+        std::copy(tailDy, tailDy + (count - i), dy + i);
+    }
+}
+#endif
+
+#if defined(PERLIN_SIMD_SSE2)
+inline void perlin_noise_batch_deriv_sse2(const float* xs, const float* ys, float z, float* out,
+    float* dx, float* dy, int count, const NoiseContext& p) {
+    int i = 0;
+    __m128 zv = _mm_set1_ps(z);
+    __m128 ddx, ddy;
+    for (; i + 4 <= count; i += 4) {
+        __m128 n = perlin_noise_deriv4(_mm_loadu_ps(xs + i), _mm_loadu_ps(ys + i), zv, p.data(), ddx, ddy);
+        _mm_storeu_ps(out + i, n);
+        _mm_storeu_ps(dx + i, ddx);
+        _mm_storeu_ps(dy + i, ddy);
+    }
+    if (i < count) {
+        alignas(16) float tailX[4] = {}, tailY[4] = {}, tailOut[4], tailDx[4], tailDy[4];
+        std::copy(xs + i, xs + count, tailX);
+        std::copy(ys + i, ys + count, tailY);
+        _mm_store_ps(tailOut, perlin_noise_deriv4(_mm_load_ps(tailX), _mm_load_ps(tailY), zv, p.data(), ddx, ddy));
+        _mm_store_ps(tailDx, ddx);
+        _mm_store_ps(tailDy, ddy);
+        std::copy(tailOut, tailOut + (count - i), out + i);
+        std::copy(tailDx, tailDx + (count - i), dx + i);
+        std::copy(tailDy, tailDy + (count - i), dy + i);
+    }
+}
+#endif
+
+inline void perlin_noise_batch_deriv_scalar(const float* xs, const float* ys, float z, float* out,
+    float* dx, float* dy, int count, const NoiseContext& p) {
+    for (int i = 0; i < count; ++i) {
+        double ddx, ddy;
+        out[i] = static_cast<float>(perlin_noise_deriv(xs[i], ys[i], z, p, ddx, ddy));
+        dx[i] = static_cast<float>(ddx);
+        dy[i] = static_cast<float>(ddy);
+    }
+}
+
+inline void perlin_noise_batch_deriv(const float* xs, const float* ys, float z, float* out,
+    float* dx, float* dy, int count, const NoiseContext& p) {
+#if defined(PERLIN_SIMD_AVX2)
+    perlin_noise_batch_deriv_avx2(xs, ys, z, out, dx, dy, count, p);
+#elif defined(PERLIN_SIMD_SSE2)
+    perlin_noise_batch_deriv_sse2(xs, ys, z, out, dx, dy, count, p);
+#else
+    perlin_noise_batch_deriv_scalar(xs, ys, z, out, dx, dy, count, p);
+#endif
+}
 
-    return p;
-}
\ No newline at end of file
+#endif // PERLIN_H
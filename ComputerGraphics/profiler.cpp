@@ -0,0 +1,151 @@
+#include "profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+
+Profiler::Profiler(bool gpuTiming, size_t historyLength)
+    : historyLength(historyLength), epoch(Clock::now()) {
+    if (!gpuTiming)
+        return;
+    gpuTimer.reset(new GpuTimer(PROFILE_PHASE_COUNT));
+
+    // The GPU clock has its own origin; note where it stands now
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpuOffsetMs = now() - gpuNow / 1.0e6;
+}
+
+double Profiler::now() const {
+    return std::chrono::duration<double, std::milli>(Clock::now() - epoch).count();
+}
+
+void Profiler::beginFrame() {
+    if (gpuTimer) {
+        // May read back the oldest frame in flight
+        gpuTimer->beginFrame();
+        collect();
+    }
+
+    Frame frame = {};
+    frame.index = frameCount;
+    frame.startMs = now();
+    inFlight.push_back(frame);
+}
+
+void Profiler::endFrame() {
+    Frame& frame = inFlight.back();
+    frame.frameMs = now() - frame.startMs;
+    ++frameCount;
+    if (gpuTimer) {
+        gpuTimer->endFrame();
+        return;
+    }
+    finishFrame(frame);
+    inFlight.pop_back();
+}
+
+void Profiler::begin(Profile_Phase phase) {
+    inFlight.back().cpuStartMs[phase] = now();
+    if (gpuTimer)
+        gpuTimer->begin(phase);
+}
+
+void Profiler::end(Profile_Phase phase) {
+    Frame& frame = inFlight.back();
+    frame.cpuMs[phase] = now() - frame.cpuStartMs[phase];
+    if (gpuTimer)
+        gpuTimer->end(phase);
+}
+
+void Profiler::finish() {
+    if (gpuTimer) {
+        gpuTimer->finish();
+        collect();
+    }
+}
+
+void Profiler::collect() {
+    GpuTimer::Frame gpu;
+    while (gpuTimer->takeFrame(gpu)) {
+        Frame& frame = inFlight.front();
+        for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+            const GpuTimer::Span& span = gpu.phases[phase];
+            if (!span.timed)
+                continue;
+            frame.gpuStartMs[phase] = span.startMs + gpuOffsetMs;
+            frame.gpuMs[phase] = span.ms;
+        }
+        finishFrame(frame);
+        inFlight.pop_front();
+    }
+}
+
+void Profiler::finishFrame(const Frame& frame) {
+    recent.push_back(frame);
+    if (recent.size() > historyLength)
+        recent.pop_front();
+    if (recording)
+        recorded.push_back(frame);
+}
+
+double Profiler::fps(size_t frames) const {
+    frames = std::min(frames, recent.size());
+    if (frames == 0)
+        return 0.0;
+    // Start to start, so time spent between endFrame() and beginFrame() counts
+    const Frame& first = recent[recent.size() - frames];
+    const Frame& last = recent.back();
+    double elapsed = last.startMs + last.frameMs - first.startMs;
+    return elapsed > 0.0 ? frames * 1000.0 / elapsed : 0.0;
+}
+
+bool Profiler::writeTrace(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    const std::string csv = ".csv";
+    if (path.size() >= csv.size() && path.compare(path.size() - csv.size(), csv.size(), csv) == 0)
+        writeCsv(out);
+    else
+        writeChromeTrace(out);
+    return static_cast<bool>(out);
+}
+
+void Profiler::writeCsv(std::ostream& out) const {
+    out << "frame,start_ms,frame_ms";
+    for (const char* name : PROFILE_PHASE_NAMES)
+        out << ',' << name << "_cpu_ms," << name << "_gpu_ms";
+    out << '\n';
+
+    for (const Frame& frame : recorded) {
+        out << frame.index << ',' << frame.startMs << ',' << frame.frameMs;
+        for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase)
+            out << ',' << frame.cpuMs[phase] << ',' << frame.gpuMs[phase];
+        out << '\n';
+    }
+}
+
+void Profiler::writeChromeTrace(std::ostream& out) const {
+    // Complete ("X") events with microsecond timestamps; thread 1 holds the
+    // frames and CPU phases, thread 2 the GPU phases
+    auto event = [&out](const char* name, int thread, double startMs, double durationMs) {
+        out << ",\n{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+            << ",\"ts\":" << startMs * 1000.0 << ",\"dur\":" << durationMs * 1000.0 << '}';
+    };
+
+    out << std::fixed;
+    out.precision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    for (const Frame& frame : recorded) {
+        event("frame", 1, frame.startMs, frame.frameMs);
+        for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+            if (frame.cpuMs[phase] > 0.0)
+                event(PROFILE_PHASE_NAMES[phase], 1, frame.cpuStartMs[phase], frame.cpuMs[phase]);
+            if (frame.gpuMs[phase] > 0.0)
+                event(PROFILE_PHASE_NAMES[phase], 2, frame.gpuStartMs[phase], frame.gpuMs[phase]);
+        }
+    }
+    out << "\n]}\n";
+}
@@ -0,0 +1,113 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gpu_timer.h"
+
+// Phases of a frame timed by the Profiler, in the order the render loop runs them
+enum Profile_Phase {
+    PROFILE_INPUT,
+    PROFILE_UPDATE,
+    PROFILE_TERRAIN_DRAW,
+    PROFILE_PROPS_DRAW,
+    PROFILE_SUN_DRAW,
+    PROFILE_OVERLAY,
+    PROFILE_SWAP,
+    PROFILE_PHASE_COUNT
+};
+const char* const PROFILE_PHASE_NAMES[] = { "input", "update", "terrain", "props", "sun", "overlay", "swap" };
+
+// Per-phase frame timing. CPU time comes from steady_clock; GPU time from a
+// GpuTimer with one query pair per phase. GPU results are read back a few
+// frames late, so a frame only reaches history() once they are in.
+//
+// With recording on, every frame is kept for writeTrace(): CSV with one row per
+// frame, or Chrome trace-event JSON (chrome://tracing, Perfetto) with the CPU
+// and GPU phases as two threads on one timeline.
+class Profiler {
+public:
+    struct Frame {
+        int index;
+        double startMs; // since the profiler was created
+        double frameMs;
+        // Start and duration of each phase; a phase that did not run has
+        // zero duration
+        double cpuStartMs[PROFILE_PHASE_COUNT];
+        double cpuMs[PROFILE_PHASE_COUNT];
+        // On the CPU clock, so they line up with the CPU phases
+        double gpuStartMs[PROFILE_PHASE_COUNT];
+        double gpuMs[PROFILE_PHASE_COUNT];
+    };
+
+    // Without gpuTiming no queries are issued and every GPU time is zero
+    explicit Profiler(bool gpuTiming = true, size_t historyLength = 240);
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void beginFrame();
+    // Call after the buffer swap (see GpuTimer::endFrame())
+    void endFrame();
+    void begin(Profile_Phase phase);
+    void end(Profile_Phase phase);
+    // Waits for the frames still in flight
+    void finish();
+
+    // The last historyLength finished frames, oldest first
+    const std::deque<Frame>& history() const { return recent; }
+    // Frames per second over the last frames of history()
+    double fps(size_t frames = 60) const;
+
+    void setRecording(bool enabled) { recording = enabled; }
+    // Writes every recorded frame, as CSV if path ends in ".csv" and as Chrome
+    // trace JSON otherwise; false if the file cannot be written
+    bool writeTrace(const std::string& path) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    size_t historyLength;
+    bool recording = false;
+    Clock::time_point epoch;
+    // Added to a GPU timestamp (in ms) to put it on the CPU clock
+    double gpuOffsetMs = 0.0;
+
+    // Null without GPU timing
+    std::unique_ptr<GpuTimer> gpuTimer;
+    // Frames waiting for their GPU results, oldest first
+    std::deque<Frame> inFlight;
+    int frameCount = 0;
+
+    std::deque<Frame> recent;
+    std::vector<Frame> recorded;
+
+    double now() const;
+    // Moves the frames whose GPU results are in to history()
+    void collect();
+    void finishFrame(const Frame& frame);
+    void writeCsv(std::ostream& out) const;
+    void writeChromeTrace(std::ostream& out) const;
+};
+
+// Scoped Profiler::begin()/end() pair
+class ProfileScope {
+public:
+    ProfileScope(Profiler& profiler, Profile_Phase phase) : profiler(profiler), phase(phase) {
+        profiler.begin(phase);
+    }
+    ~ProfileScope() { profiler.end(phase); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler& profiler;
+    Profile_Phase phase;
+};
+
+#endif // PROFILER_H
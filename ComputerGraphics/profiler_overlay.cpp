@@ -0,0 +1,149 @@
+#include "profiler_overlay.h"
+#include "gl_buffer.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+const glm::vec4 PhaseColors[PROFILE_PHASE_COUNT] = {
+    { 0.6f, 0.6f, 0.6f, 1.0f }, // input
+    { 0.9f, 0.8f, 0.2f, 1.0f }, // update
+    { 0.3f, 0.8f, 0.3f, 1.0f }, // terrain
+    { 0.1f, 0.5f, 0.3f, 1.0f }, // props
+    { 1.0f, 0.5f, 0.1f, 1.0f }, // sun
+    { 0.7f, 0.4f, 0.9f, 1.0f }, // overlay
+    { 0.3f, 0.6f, 1.0f, 1.0f }, // swap
+};
+
+const float TextSize = 16.0f;
+const float Margin = 10.0f;
+const float Padding = 8.0f;
+const float BarWidth = 2.0f;
+const float GraphHeight = 100.0f;
+// Frames averaged for the text
+const size_t AverageFrames = 60;
+
+} // namespace
+
+ProfilerOverlay::ProfilerOverlay(Shader& shader, TextRenderer& text) : shader(shader), text(text) {
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+}
+
+ProfilerOverlay::~ProfilerOverlay() {
+    glDeleteBuffers(1, &VBO);
+    glDeleteVertexArrays(1, &VAO);
+}
+
+void ProfilerOverlay::addRect(float x0, float y0, float x1, float y1, const glm::vec4& color) {
+    const float corners[6][2] = { { x0, y0 }, { x0, y1 }, { x1, y1 }, { x0, y0 }, { x1, y1 }, { x1, y0 } };
+    for (const auto& corner : corners) {
+        vertices.insert(vertices.end(), { corner[0], corner[1], color.r, color.g, color.b, color.a });
+    }
+}
+
+void ProfilerOverlay::draw(const Profiler& profiler, int viewportWidth, int viewportHeight) {
+    const std::deque<Profiler::Frame>& history = profiler.history();
+
+    // Average of the latest frames
+    size_t averaged = std::min(AverageFrames, history.size());
+    double frameMs = 0.0, cpuMs[PROFILE_PHASE_COUNT] = {}, gpuMs[PROFILE_PHASE_COUNT] = {};
+    for (size_t i = history.size() - averaged; i < history.size(); ++i) {
+        frameMs += history[i].frameMs;
+        for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+            cpuMs[phase] += history[i].cpuMs[phase];
+            gpuMs[phase] += history[i].gpuMs[phase];
+        }
+    }
+    if (averaged > 0) {
+        frameMs /= averaged;
+        for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+            cpuMs[phase] /= averaged;
+            gpuMs[phase] /= averaged;
+        }
+    }
+
+    // Text block: FPS line, column headings, one line per phase
+    float line = text.loaded() ? text.lineHeight(TextSize) : 0.0f;
+    int textLines = text.loaded() ? 2 + PROFILE_PHASE_COUNT : 0;
+    float graphWidth = BarWidth * std::max<size_t>(history.size(), 1);
+    float panelWidth = std::max(graphWidth, 24.0f * line) + 2.0f * Padding;
+    float graphTop = Margin + Padding + textLines * line + (textLines > 0 ? Padding : 0.0f);
+    float graphBottom = graphTop + GraphHeight;
+
+    // Smallest scale of 1/60 s doubled until the slowest frame fits
+    double slowest = 0.0;
+    for (const Profiler::Frame& frame : history) {
+        double cpu = 0.0;
+        for (double ms : frame.cpuMs)
+            cpu += ms;
+        slowest = std::max(slowest, cpu);
+    }
+    double scaleMs = 1000.0 / 60.0;
+    while (scaleMs < slowest && scaleMs < 1000.0)
+        scaleMs *= 2.0;
+    float pixelsPerMs = static_cast<float>(GraphHeight / scaleMs);
+
+    vertices.clear();
+    addRect(Margin, Margin, Margin + panelWidth, graphBottom + Padding, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+    float graphLeft = Margin + Padding;
+    for (size_t i = 0; i < history.size(); ++i) {
+        float x = graphLeft + i * BarWidth;
+        float y = graphBottom;
+        for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+            float height = static_cast<float>(history[i].cpuMs[phase]) * pixelsPerMs;
+            float top = std::max(y - height, graphTop);
+            addRect(x, top, x + BarWidth, y, PhaseColors[phase]);
+            y = top;
+        }
+    }
+    // 1/60 s marks
+    for (double ms = 1000.0 / 60.0; ms <= scaleMs + 0.001; ms += 1000.0 / 60.0) {
+        float y = graphBottom - static_cast<float>(ms) * pixelsPerMs;
+        addRect(graphLeft, y, graphLeft + graphWidth, y + 1.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.35f));
+    }
+    if (text.loaded()) {
+        for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+            float baseline = Margin + Padding + (3 + phase) * line;
+            addRect(graphLeft, baseline - 0.7f * line, graphLeft + 0.7f * line, baseline, PhaseColors[phase]);
+        }
+    }
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    orphanAndUpload(GL_ARRAY_BUFFER, VBO, vertices.size() * sizeof(float), vertices.data());
+    shader.use();
+    shader.setVec2("viewportSize", static_cast<float>(viewportWidth), static_cast<float>(viewportHeight));
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size() / 6));
+    glBindVertexArray(0);
+
+    // Queue the text; the renderer draws it with the rest of the frame's text
+    if (text.loaded()) {
+        char buffer[128];
+        std::snprintf(buffer, sizeof(buffer), "%5.1f FPS  %6.2f ms  (graph: %.0f ms)",
+            profiler.fps(AverageFrames), frameMs, scaleMs);
+        std::string lines = buffer;
+        lines += "\n     phase   cpu ms  gpu ms";
+        for (int phase = 0; phase < PROFILE_PHASE_COUNT; ++phase) {
+            std::snprintf(buffer, sizeof(buffer), "\n  %8s %7.2f %7.2f", PROFILE_PHASE_NAMES[phase],
+                cpuMs[phase], gpuMs[phase]);
+            lines += buffer;
+        }
+        text.add(lines, graphLeft, Margin + Padding + line, TextSize, glm::vec4(1.0f));
+    }
+
+    glDisable(GL_BLEND);
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+}
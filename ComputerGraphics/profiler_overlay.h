@@ -0,0 +1,38 @@
+#ifndef PROFILER_OVERLAY_H
+#define PROFILER_OVERLAY_H
+
+#include <glad/glad.h>
+#include <vector>
+#include "profiler.h"
+#include "shader.h"
+#include "text.h"
+
+// Draws a Profiler's history over the frame: FPS and the average CPU and GPU
+// time of each phase as text, and a graph of the recent frames with each
+// frame's CPU time stacked by phase. The graph's scale doubles whenever frames
+// no longer fit, from 1/60 s up.
+class ProfilerOverlay {
+public:
+    // shader: overlay_vertex.glsl / overlay_fragment.glsl. Without a loaded
+    // text renderer only the graph is drawn.
+    ProfilerOverlay(Shader& shader, TextRenderer& text);
+    ~ProfilerOverlay();
+
+    ProfilerOverlay(const ProfilerOverlay&) = delete;
+    ProfilerOverlay& operator=(const ProfilerOverlay&) = delete;
+
+    // Draws the panel and graph and queues the text on the TextRenderer, whose
+    // draw() has to follow
+    void draw(const Profiler& profiler, int viewportWidth, int viewportHeight);
+
+private:
+    Shader& shader;
+    TextRenderer& text;
+    unsigned int VAO, VBO;
+    // Position (pixels) and RGBA colour of each vertex of this frame's quads
+    std::vector<float> vertices;
+
+    void addRect(float x0, float y0, float x1, float y1, const glm::vec4& color);
+};
+
+#endif // PROFILER_OVERLAY_H
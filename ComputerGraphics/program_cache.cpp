@@ -0,0 +1,129 @@
+#include "program_cache.h"
+#include "cache_file.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const std::uint32_t Magic = 0x42504c47; // "GLPB"
+
+// fnv1a of a string, continued from hash
+std::uint64_t hashString(const std::string& s, std::uint64_t hash = FnvOffsetBasis) {
+    // Separator so ("ab", "c") and ("a", "bc") hash differently
+    const unsigned char separator = 0xff;
+    return fnv1a(&separator, 1, fnv1a(s.data(), s.size(), hash));
+}
+
+std::string glString(GLenum name) {
+    const char* s = reinterpret_cast<const char*>(glGetString(name));
+    return s ? s : "";
+}
+
+std::string cachePath(const std::string& key) {
+    return std::string(PROGRAM_CACHE_DIRECTORY) + "/" + key + ".bin";
+}
+
+} // namespace
+
+bool ProgramCache::supported() {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+    static const bool available = [] {
+        bool extension = false;
+#ifdef GL_VERSION_4_1
+        extension = extension || GLAD_GL_VERSION_4_1;
+#endif
+#ifdef GL_ARB_get_program_binary
+        extension = extension || GLAD_GL_ARB_get_program_binary;
+#endif
+        // Some drivers expose the entry points but no binary formats
+        GLint formats = 0;
+        if (extension)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+std::string ProgramCache::key(const std::string& vertexCode, const std::string& fragmentCode) {
+    std::uint64_t hash = hashString(vertexCode);
+    hash = hashString(fragmentCode, hash);
+    hash = hashString(glString(GL_VENDOR), hash);
+    hash = hashString(glString(GL_RENDERER), hash);
+    hash = hashString(glString(GL_VERSION), hash);
+
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return hex;
+}
+
+unsigned int ProgramCache::load(const std::string& key) {
+    if (!supported())
+        return 0;
+
+    std::ifstream file(cachePath(key), std::ios::binary | std::ios::ate);
+    std::streamoff fileSize = file.tellg();
+    file.seekg(0);
+    std::uint32_t header[3]; // magic, binary format, length
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != Magic)
+        return 0;
+    // A corrupt or truncated entry is a miss, not an allocation of whatever
+    // its length field claims
+    if (static_cast<std::uint64_t>(fileSize) != sizeof(header) + static_cast<std::uint64_t>(header[2]))
+        return 0;
+    std::vector<char> binary(header[2]);
+    if (!file.read(binary.data(), binary.size()))
+        return 0;
+
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, header[1], binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked)
+        return program;
+    glDeleteProgram(program);
+#endif
+    return 0;
+}
+
+void ProgramCache::prepare(unsigned int program) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+    if (supported())
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+}
+
+void ProgramCache::store(const std::string& key, unsigned int program) {
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+    GLint linked = GL_FALSE, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!supported() || !linked)
+        return;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+#ifdef _WIN32
+    _mkdir(PROGRAM_CACHE_DIRECTORY);
+#else
+    mkdir(PROGRAM_CACHE_DIRECTORY, 0755);
+#endif
+
+    std::uint32_t header[3] = { Magic, format, static_cast<std::uint32_t>(length) };
+    atomicWriteFile(cachePath(key), header, sizeof(header), binary.data(), length);
+#endif
+}
@@ -0,0 +1,34 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+#include <string>
+
+// On-disk cache of linked program binaries (glGetProgramBinary /
+// glProgramBinary), so warm starts skip compiling and linking GLSL. Entries
+// live in PROGRAM_CACHE_DIRECTORY, one file per key; the key hashes the
+// shader sources together with the driver's vendor, renderer and version
+// strings, so editing a shader or updating the driver simply misses the cache.
+// A binary the driver rejects is treated as a miss and overwritten by the
+// freshly compiled program.
+//
+// Needs GL 4.1 or ARB_get_program_binary; everything is a no-op without it.
+const char* const PROGRAM_CACHE_DIRECTORY = "shader_cache";
+
+class ProgramCache {
+public:
+    static bool supported();
+
+    static std::string key(const std::string& vertexCode, const std::string& fragmentCode);
+
+    // Creates a program from the cached binary for key, or returns 0 if there
+    // is none or the driver no longer accepts it
+    static unsigned int load(const std::string& key);
+
+    // Call before linking a program that will be stored
+    static void prepare(unsigned int program);
+    // Saves a successfully linked program under key
+    static void store(const std::string& key, unsigned int program);
+};
+
+#endif // PROGRAM_CACHE_H
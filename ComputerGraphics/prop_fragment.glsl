@@ -0,0 +1,23 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 Color;
+
+// Per-frame values shared by every program (FrameUniforms in frame_uniforms.h)
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 lightPos;
+    float lightIntensity;
+    vec3 viewPos;
+};
+
+void main() {
+    // Ambient and diffuse, as on the terrain; props are matte
+    vec3 ambient = 0.1 * lightIntensity * vec3(1.0);
+    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 diffuse = max(dot(normalize(Normal), lightDir), 0.0) * lightIntensity * vec3(1.0);
+    FragColor = vec4((ambient + diffuse) * Color, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,325 @@
+#include "prop_renderer.h"
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <utility>
+#include "gl_buffer.h"
+#include "sphere.h"
+
+const float PropRenderer::CellSize = 160.0f;
+
+namespace {
+
+// position (3), normal (3), color (3)
+const int VertexFloats = 9;
+
+// Props tried per cell of each type; trees on unsuitable ground are skipped
+const int PropsPerCell[PROP_TYPE_COUNT] = { 80, 40 };
+
+// Trees grow between these heights (the green band of terrain_fragment.glsl)
+// and on slopes no steeper than MaxTreeSlope
+const float TreeLineLow = -5.0f;
+const float TreeLineHigh = 90.0f;
+const float MaxTreeSlope = 0.6f;
+
+struct MeshData {
+    std::vector<float> vertices;
+    std::vector<unsigned short> indices;
+};
+
+// Index of a vertex, reusing an identical one already in the mesh. The meshes
+// are a few hundred vertices, so a linear search is enough.
+unsigned short addVertex(MeshData& mesh, const glm::vec3& position, const glm::vec3& normal, const glm::vec3& color) {
+    const float vertex[VertexFloats] = { position.x, position.y, position.z, normal.x, normal.y, normal.z,
+        color.r, color.g, color.b };
+    size_t count = mesh.vertices.size() / VertexFloats;
+    for (size_t i = 0; i < count; ++i) {
+        if (std::equal(vertex, vertex + VertexFloats, &mesh.vertices[i * VertexFloats]))
+            return static_cast<unsigned short>(i);
+    }
+    mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + VertexFloats);
+    return static_cast<unsigned short>(count);
+}
+
+// Flat-shaded triangle, wound and lit to face away from center
+void addTriangle(MeshData& mesh, glm::vec3 a, glm::vec3 b, glm::vec3 c, const glm::vec3& center, const glm::vec3& color) {
+    glm::vec3 normal = glm::cross(b - a, c - a);
+    if (glm::length(normal) < 1e-6f)
+        return;
+    normal = glm::normalize(normal);
+    if (glm::dot(normal, (a + b + c) / 3.0f - center) < 0.0f) {
+        std::swap(b, c);
+        normal = -normal;
+    }
+    mesh.indices.push_back(addVertex(mesh, a, normal, color));
+    mesh.indices.push_back(addVertex(mesh, b, normal, color));
+    mesh.indices.push_back(addVertex(mesh, c, normal, color));
+}
+
+// Open-ended cylinder between two heights, tapering from bottomRadius to
+// topRadius; a zero topRadius makes a cone, closed underneath
+void addTaperedCylinder(MeshData& mesh, int sides, float bottom, float bottomRadius, float top, float topRadius,
+    const glm::vec3& color) {
+    glm::vec3 center(0.0f, 0.5f * (bottom + top), 0.0f);
+    for (int i = 0; i < sides; ++i) {
+        float a0 = 2.0f * glm::pi<float>() * i / sides, a1 = 2.0f * glm::pi<float>() * (i + 1) / sides;
+        glm::vec3 bottom0(bottomRadius * std::cos(a0), bottom, bottomRadius * std::sin(a0));
+        glm::vec3 bottom1(bottomRadius * std::cos(a1), bottom, bottomRadius * std::sin(a1));
+        glm::vec3 top0(topRadius * std::cos(a0), top, topRadius * std::sin(a0));
+        glm::vec3 top1(topRadius * std::cos(a1), top, topRadius * std::sin(a1));
+        addTriangle(mesh, bottom0, bottom1, top1, center, color);
+        if (topRadius > 0.0f)
+            addTriangle(mesh, bottom0, top1, top0, center, color);
+        else
+            addTriangle(mesh, bottom0, bottom1, glm::vec3(0.0f, bottom, 0.0f), center, color);
+    }
+}
+
+// Conifer about 25 units tall: a trunk under three stacked cones
+MeshData treeMesh() {
+    MeshData mesh;
+    addTaperedCylinder(mesh, 6, -1.0f, 1.0f, 7.0f, 0.7f, glm::vec3(0.40f, 0.26f, 0.13f));
+    addTaperedCylinder(mesh, 7, 4.0f, 6.5f, 15.0f, 0.0f, glm::vec3(0.10f, 0.33f, 0.12f));
+    addTaperedCylinder(mesh, 7, 10.0f, 4.8f, 21.0f, 0.0f, glm::vec3(0.13f, 0.38f, 0.15f));
+    addTaperedCylinder(mesh, 7, 16.0f, 3.0f, 25.0f, 0.0f, glm::vec3(0.16f, 0.43f, 0.18f));
+    return mesh;
+}
+
+// Boulder about 8 units across: a coarse sphere, dented and squashed
+MeshData rockMesh() {
+    std::vector<glm::vec3> points;
+    std::vector<unsigned int> triangles;
+    Sphere::generateMesh(4.0f, 7, 5, points, triangles);
+
+    for (glm::vec3& p : points) {
+        // generateMesh puts the poles on z; stand it on y. The dents depend
+        // only on the position, so the seam's duplicate vertices move alike.
+        p = glm::vec3(p.x, p.z, p.y);
+        p *= 1.0f + 0.15f * std::sin(1.3f * p.x + 1.0f) * std::sin(1.1f * p.z + 2.0f) + 0.08f * std::sin(2.1f * p.y);
+        p.y = 0.6f * p.y + 0.8f;
+    }
+
+    MeshData mesh;
+    glm::vec3 center(0.0f, 0.8f, 0.0f);
+    for (size_t i = 0; i + 2 < triangles.size(); i += 3)
+        addTriangle(mesh, points[triangles[i]], points[triangles[i + 1]], points[triangles[i + 2]], center,
+            glm::vec3(0.45f, 0.43f, 0.40f));
+    return mesh;
+}
+
+} // namespace
+
+PropRenderer::PropRenderer(unsigned int seed, float range) : seed(seed), range(range) {
+    const MeshData data[PROP_TYPE_COUNT] = { treeMesh(), rockMesh() };
+    for (int type = 0; type < PROP_TYPE_COUNT; ++type) {
+        Mesh& mesh = meshes[type];
+        const std::vector<float>& vertices = data[type].vertices;
+        mesh.bottom = FLT_MAX;
+        mesh.top = -FLT_MAX;
+        for (size_t i = 0; i < vertices.size(); i += VertexFloats) {
+            mesh.radius = std::max(mesh.radius, std::sqrt(vertices[i] * vertices[i] + vertices[i + 2] * vertices[i + 2]));
+            mesh.bottom = std::min(mesh.bottom, vertices[i + 1]);
+            mesh.top = std::max(mesh.top, vertices[i + 1]);
+        }
+        mesh.indexCount = static_cast<int>(data[type].indices.size());
+
+        glGenVertexArrays(1, &mesh.VAO);
+        glGenBuffers(1, &mesh.VBO);
+        glGenBuffers(1, &mesh.EBO);
+        glGenBuffers(1, &mesh.instanceVBO);
+
+        glBindVertexArray(mesh.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, data[type].indices.size() * sizeof(unsigned short),
+            data[type].indices.data(), GL_STATIC_DRAW);
+
+        // Position, normal and color
+        for (int attribute = 0; attribute < 3; ++attribute) {
+            glVertexAttribPointer(attribute, 3, GL_FLOAT, GL_FALSE, VertexFloats * sizeof(float),
+                (void*)(attribute * 3 * sizeof(float)));
+            glEnableVertexAttribArray(attribute);
+        }
+
+        // Per-instance attributes: position and scale, then rotation
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.instanceVBO);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, position));
+        glEnableVertexAttribArray(3);
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, cosYaw));
+        glEnableVertexAttribArray(4);
+        glVertexAttribDivisor(4, 1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+}
+
+PropRenderer::~PropRenderer() {
+    for (Mesh& mesh : meshes) {
+        glDeleteVertexArrays(1, &mesh.VAO);
+        glDeleteBuffers(1, &mesh.VBO);
+        glDeleteBuffers(1, &mesh.EBO);
+        glDeleteBuffers(1, &mesh.instanceVBO);
+    }
+}
+
+void PropRenderer::update(const ChunkManager& terrain, const glm::vec3& cameraPos, const glm::mat4& viewProjection) {
+    // Squared distance from the camera to the nearest point of a cell
+    auto cellDistance2 = [&cameraPos](int x, int z) {
+        float dx = std::max(std::max(x * CellSize - cameraPos.x, cameraPos.x - (x + 1) * CellSize), 0.0f);
+        float dz = std::max(std::max(z * CellSize - cameraPos.z, cameraPos.z - (z + 1) * CellSize), 0.0f);
+        return dx * dx + dz * dz;
+    };
+
+    // Release cells a cell beyond range, so one on the edge is not dropped
+    // and placed again as the camera moves back and forth
+    float releaseRange = range + CellSize;
+    for (auto it = cells.begin(); it != cells.end();) {
+        if (cellDistance2(it->first.x, it->first.z) > releaseRange * releaseRange) {
+            for (const std::vector<Instance>& props : it->second.props)
+                placed -= static_cast<int>(props.size());
+            it = cells.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    // Populate the cells in range; those whose terrain is still streaming in
+    // are tried again next frame
+    int xBegin = static_cast<int>(std::floor((cameraPos.x - range) / CellSize));
+    int xEnd = static_cast<int>(std::floor((cameraPos.x + range) / CellSize));
+    int zBegin = static_cast<int>(std::floor((cameraPos.z - range) / CellSize));
+    int zEnd = static_cast<int>(std::floor((cameraPos.z + range) / CellSize));
+    for (int z = zBegin; z <= zEnd; ++z) {
+        for (int x = xBegin; x <= xEnd; ++x) {
+            CellKey key = { x, z };
+            if (cellDistance2(x, z) > range * range || cells.count(key))
+                continue;
+            Cell cell;
+            if (!populate(key, terrain, cell))
+                continue;
+            for (const std::vector<Instance>& props : cell.props)
+                placed += static_cast<int>(props.size());
+            cells.emplace(key, std::move(cell));
+        }
+    }
+
+    // Cull whole cells first; only the props of cells on the frustum's
+    // boundary need testing one by one
+    Frustum frustum(viewProjection);
+    for (Mesh& mesh : meshes)
+        mesh.visible.clear();
+    for (const auto& entry : cells) {
+        const Cell& cell = entry.second;
+        Frustum_Test cellTest = frustum.testAABB(cell.boundsMin, cell.boundsMax);
+        if (cellTest == OUTSIDE)
+            continue;
+        for (int type = 0; type < PROP_TYPE_COUNT; ++type) {
+            std::vector<Instance>& visible = meshes[type].visible;
+            if (cellTest == INSIDE) {
+                visible.insert(visible.end(), cell.props[type].begin(), cell.props[type].end());
+                continue;
+            }
+            for (const Instance& instance : cell.props[type]) {
+                glm::vec3 boxMin, boxMax;
+                instanceBounds(static_cast<Prop_Type>(type), instance, boxMin, boxMax);
+                if (frustum.testAABB(boxMin, boxMax) != OUTSIDE)
+                    visible.push_back(instance);
+            }
+        }
+    }
+}
+
+void PropRenderer::invalidate(float x, float z, float radius) {
+    for (auto it = cells.begin(); it != cells.end();) {
+        float dx = std::max(std::max(it->first.x * CellSize - x, x - (it->first.x + 1) * CellSize), 0.0f);
+        float dz = std::max(std::max(it->first.z * CellSize - z, z - (it->first.z + 1) * CellSize), 0.0f);
+        if (dx * dx + dz * dz <= radius * radius) {
+            for (const std::vector<Instance>& props : it->second.props)
+                placed -= static_cast<int>(props.size());
+            it = cells.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void PropRenderer::Draw(Shader& shader) {
+    shader.use();
+    for (Mesh& mesh : meshes) {
+        if (mesh.visible.empty())
+            continue;
+
+        orphanAndUpload(GL_ARRAY_BUFFER, mesh.instanceVBO, mesh.visible.size() * sizeof(Instance),
+            mesh.visible.data());
+        glBindVertexArray(mesh.VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_SHORT, 0,
+            static_cast<GLsizei>(mesh.visible.size()));
+        glBindVertexArray(0);
+    }
+}
+
+int PropRenderer::drawnProps() const {
+    int count = 0;
+    for (const Mesh& mesh : meshes)
+        count += static_cast<int>(mesh.visible.size());
+    return count;
+}
+
+bool PropRenderer::populate(const CellKey& key, const ChunkManager& terrain, Cell& cell) const {
+    // Most cells that fail are wholly unstreamed; find out before placing anything
+    float height;
+    if (!terrain.detailHeightAt((key.x + 0.5f) * CellSize, (key.z + 0.5f) * CellSize, height))
+        return false;
+
+    // Raw mt19937 output rather than a distribution, as in NoiseContext, so a
+    // seed places the same props on every platform
+    std::mt19937 generator(seed ^ (static_cast<unsigned int>(key.x) * 73856093u)
+        ^ (static_cast<unsigned int>(key.z) * 19349663u));
+    auto random = [&generator]() { return static_cast<float>(generator() >> 8) * (1.0f / 16777216.0f); };
+
+    cell.boundsMin = glm::vec3(FLT_MAX);
+    cell.boundsMax = glm::vec3(-FLT_MAX);
+    for (int type = 0; type < PROP_TYPE_COUNT; ++type) {
+        cell.props[type].reserve(PropsPerCell[type]);
+        for (int i = 0; i < PropsPerCell[type]; ++i) {
+            float x = (key.x + random()) * CellSize;
+            float z = (key.z + random()) * CellSize;
+            float yaw = random() * 2.0f * glm::pi<float>();
+            float scale = type == PROP_TREE ? 0.7f + 0.6f * random() : 0.4f + 1.0f * random();
+            if (!terrain.detailHeightAt(x, z, height))
+                return false;
+
+            if (type == PROP_TREE) {
+                float heightX, heightZ;
+                if (!terrain.detailHeightAt(x + 1.0f, z, heightX) || !terrain.detailHeightAt(x, z + 1.0f, heightZ))
+                    return false;
+                float slope = std::max(std::abs(heightX - height), std::abs(heightZ - height));
+                if (height < TreeLineLow || height > TreeLineHigh || slope > MaxTreeSlope)
+                    continue;
+            }
+
+            Instance instance = { glm::vec3(x, height, z), scale, std::cos(yaw), std::sin(yaw) };
+            cell.props[type].push_back(instance);
+            glm::vec3 boxMin, boxMax;
+            instanceBounds(static_cast<Prop_Type>(type), instance, boxMin, boxMax);
+            cell.boundsMin = glm::min(cell.boundsMin, boxMin);
+            cell.boundsMax = glm::max(cell.boundsMax, boxMax);
+        }
+    }
+    return true;
+}
+
+void PropRenderer::instanceBounds(Prop_Type type, const Instance& instance, glm::vec3& boxMin, glm::vec3& boxMax) const {
+    // The radius about y bounds the mesh at any rotation
+    const Mesh& mesh = meshes[type];
+    float radius = mesh.radius * instance.scale;
+    boxMin = instance.position + glm::vec3(-radius, mesh.bottom * instance.scale, -radius);
+    boxMax = instance.position + glm::vec3(radius, mesh.top * instance.scale, radius);
+}
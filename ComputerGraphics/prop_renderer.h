@@ -0,0 +1,108 @@
+#ifndef PROP_RENDERER_H
+#define PROP_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include "chunk_manager.h"
+#include "frustum.h"
+#include "shader.h"
+
+// Kinds of prop scattered over the terrain, one mesh each
+enum Prop_Type {
+    PROP_TREE,
+    PROP_ROCK,
+    PROP_TYPE_COUNT
+};
+
+// Scatters trees and rocks over the terrain around the camera and draws every
+// prop of a type with one glDrawElementsInstanced call.
+//
+// The ground is divided into square cells. A cell is populated once the
+// full-resolution terrain under it is resident: its props are placed at random
+// from a generator seeded by the cell and the terrain's seed (so a landscape
+// always gets the same props) and stood on ChunkManager::detailHeightAt().
+// Cells are released again once the camera has moved away.
+//
+// Each frame the cells are frustum culled on the CPU, then the props of cells
+// that straddle the frustum one by one; the position, scale and rotation of
+// the visible props are streamed into one instance buffer per type.
+class PropRenderer {
+public:
+    // seed: placement seed (the terrain's, for the same props on every run),
+    // range: distance from the camera props are placed within; keep it inside
+    // the range of the finest terrain level (GL thread only)
+    explicit PropRenderer(unsigned int seed, float range = 1200.0f);
+    ~PropRenderer();
+
+    PropRenderer(const PropRenderer&) = delete;
+    PropRenderer& operator=(const PropRenderer&) = delete;
+
+    // Populates cells newly in range whose terrain has arrived, releases cells
+    // left behind and collects the props inside the frustum of viewProjection
+    void update(const ChunkManager& terrain, const glm::vec3& cameraPos, const glm::mat4& viewProjection);
+    // Re-places the props of every cell within radius of world (x, z) on the
+    // next update(), e.g. after a terrain edit there
+    void invalidate(float x, float z, float radius);
+
+    // Draws the props collected by the last update() with shader, one call per type
+    void Draw(Shader& shader);
+
+    int cellCount() const { return static_cast<int>(cells.size()); }
+    // Props placed in all cells, and drawn by the last update()
+    int placedProps() const { return placed; }
+    int drawnProps() const;
+
+private:
+    // Cells are this many world units square
+    static const float CellSize;
+
+    // Per-instance data: world position of the mesh origin, uniform scale, and
+    // the cosine and sine of the rotation about y
+    struct Instance {
+        glm::vec3 position;
+        float scale;
+        float cosYaw, sinYaw;
+    };
+
+    // A flat-shaded mesh with position, normal and color per vertex
+    struct Mesh {
+        unsigned int VAO = 0, VBO = 0, EBO = 0, instanceVBO = 0;
+        int indexCount = 0;
+        // Bounds of the unscaled mesh: its radius about the y axis and its
+        // lowest and highest point
+        float radius = 0.0f, bottom = 0.0f, top = 0.0f;
+        // Props of this type drawn this frame
+        std::vector<Instance> visible;
+    };
+
+    struct CellKey {
+        int x, z;
+        bool operator==(const CellKey& o) const { return x == o.x && z == o.z; }
+    };
+
+    struct CellKeyHash {
+        std::size_t operator()(const CellKey& k) const {
+            return (static_cast<std::size_t>(k.x) * 73856093u) ^ (static_cast<std::size_t>(k.z) * 19349663u);
+        }
+    };
+
+    struct Cell {
+        std::vector<Instance> props[PROP_TYPE_COUNT];
+        glm::vec3 boundsMin, boundsMax;
+    };
+
+    unsigned int seed;
+    float range;
+    int placed = 0;
+    Mesh meshes[PROP_TYPE_COUNT];
+    std::unordered_map<CellKey, Cell, CellKeyHash> cells;
+
+    // Places the props of a cell; false if the terrain under it is not resident yet
+    bool populate(const CellKey& key, const ChunkManager& terrain, Cell& cell) const;
+    void instanceBounds(Prop_Type type, const Instance& instance, glm::vec3& boxMin, glm::vec3& boxMax) const;
+};
+
+#endif // PROP_RENDERER_H
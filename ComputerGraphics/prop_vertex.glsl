@@ -0,0 +1,34 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec3 aColor;
+
+// Per instance (see PropRenderer): world position and scale, and the cosine
+// and sine of the rotation about y
+layout (location = 3) in vec4 aPlacement;
+layout (location = 4) in vec2 aRotation;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+
+// Per-frame values shared by every program (FrameUniforms in frame_uniforms.h)
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 lightPos;
+    float lightIntensity;
+    vec3 viewPos;
+};
+
+vec3 rotateY(vec3 v) {
+    return vec3(aRotation.x * v.x + aRotation.y * v.z, v.y, aRotation.x * v.z - aRotation.y * v.x);
+}
+
+void main()
+{
+    FragPos = aPlacement.xyz + aPlacement.w * rotateY(aPos);
+    Normal = rotateY(aNormal);
+    Color = aColor;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
@@ -1,9 +1,13 @@
 #include "shader.h"
+#include "frame_uniforms.h"
+#include "logger.h"
+#include "program_cache.h"
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
+namespace {
+
+// Reads both sources; false (after reporting the error) if either can't be read
+bool readSources(const std::string& vertexPath, const std::string& fragmentPath,
+    std::string& vertexCode, std::string& fragmentCode) {
     std::ifstream vShaderFile;
     std::ifstream fShaderFile;
 
@@ -29,108 +33,273 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         fragmentCode = fShaderStream.str();
     }
     catch (std::ifstream::failure& e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+        LOG(LOG_ERROR) << "Shader file not successfully read: " << e.what();
+        return false;
     }
+    return true;
+}
 
+// Submits the compiles and the link; nothing here waits for the driver
+unsigned int submitProgram(const std::string& vertexCode, const std::string& fragmentCode,
+    unsigned int& vertexShader, unsigned int& fragmentShader) {
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
 
-    // 2. compile shaders
-    unsigned int vertex, fragment;
-
     // vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+    vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vShaderCode, NULL);
+    glCompileShader(vertexShader);
 
     // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
+    glCompileShader(fragmentShader);
 
     // shader Program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    ProgramCache::prepare(program);
+    glLinkProgram(program);
+    return program;
+}
 
-    // delete the shaders as they're linked into our program and no longer necessary
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+bool parallelCompile() {
+#ifdef GL_KHR_parallel_shader_compile
+    return GLAD_GL_KHR_parallel_shader_compile != 0;
+#else
+    return false;
+#endif
+}
+
+bool completed(unsigned int program) {
+#ifdef GL_KHR_parallel_shader_compile
+    if (parallelCompile()) {
+        GLint complete = GL_FALSE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
+#endif
+    return false;
+}
+
+} // namespace
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath)
+    : vertexPath(vertexPath), fragmentPath(fragmentPath) {
+    // 1. retrieve the vertex/fragment source code from filePath
+    std::string vertexCode;
+    std::string fragmentCode;
+    readSources(vertexPath, fragmentPath, vertexCode, fragmentCode);
+
+    // 2. reuse the program linked on a previous run if the driver still accepts it
+    cacheKey = ProgramCache::key(vertexCode, fragmentCode);
+    ID = ProgramCache::load(cacheKey);
+
+    // 3. otherwise submit the compiles and the link; results are checked in finish()
+    if (ID == 0)
+        ID = submitProgram(vertexCode, fragmentCode, vertexShader, fragmentShader);
+    pending = true;
+}
+
+bool Shader::isReady() const {
+    if (!pending || vertexShader == 0)
+        return true;
+    // Without the extension any status query may block, so this reports not
+    // ready and leaves it to the caller to decide when to wait
+    return completed(ID);
+}
+
+void Shader::finish() {
+    if (!pending)
+        return;
+    pending = false;
+
+    if (vertexShader != 0) {
+        checkCompileErrors(vertexShader, "VERTEX");
+        checkCompileErrors(fragmentShader, "FRAGMENT");
+        checkCompileErrors(ID, "PROGRAM");
+
+        // delete the shaders as they're linked into our program and no longer necessary
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        vertexShader = fragmentShader = 0;
+
+        ProgramCache::store(cacheKey, ID);
+    }
+
+    reflectUniforms();
+}
+
+bool Shader::uses(const std::string& path) const {
+    return path == vertexPath || path == fragmentPath;
+}
+
+bool Shader::reload() {
+    finish();
+
+    std::string vertexCode, fragmentCode;
+    if (!readSources(vertexPath, fragmentPath, vertexCode, fragmentCode))
+        return false;
+    std::string key = ProgramCache::key(vertexCode, fragmentCode);
+    if (key == cacheKey || (reloadProgram != 0 && key == reloadKey))
+        return false; // Saved without changes, or already compiling this version
+
+    discardReload();
+    reloadKey = key;
+    reloadProgram = ProgramCache::load(reloadKey);
+    if (reloadProgram == 0)
+        reloadProgram = submitProgram(vertexCode, fragmentCode, reloadVertexShader, reloadFragmentShader);
+    return true;
+}
+
+Shader::ReloadStatus Shader::pollReload(bool wait) {
+    if (reloadProgram == 0)
+        return ReloadStatus::None;
+    // Without the extension there is no way to tell, so finish it now
+    if (reloadVertexShader != 0 && !wait && parallelCompile() && !completed(reloadProgram))
+        return ReloadStatus::Pending;
+
+    bool compiled = true;
+    if (reloadVertexShader != 0) {
+        // Check all three so every error gets reported
+        compiled = checkCompileErrors(reloadVertexShader, "VERTEX") && compiled;
+        compiled = checkCompileErrors(reloadFragmentShader, "FRAGMENT") && compiled;
+        compiled = checkCompileErrors(reloadProgram, "PROGRAM") && compiled;
+    }
+    if (!compiled) {
+        // Keep drawing with the last program that worked
+        discardReload();
+        return ReloadStatus::Failed;
+    }
+
+    if (reloadVertexShader != 0) {
+        ProgramCache::store(reloadKey, reloadProgram);
+        glDeleteShader(reloadVertexShader);
+        glDeleteShader(reloadFragmentShader);
+        reloadVertexShader = reloadFragmentShader = 0;
+    }
+    glDeleteProgram(ID);
+    ID = reloadProgram;
+    cacheKey = reloadKey;
+    reloadProgram = 0;
+    uniformLocations.clear();
+    reflectUniforms();
+    return ReloadStatus::Swapped;
+}
+
+void Shader::discardReload() {
+    if (reloadProgram == 0)
+        return;
+    glDeleteShader(reloadVertexShader);
+    glDeleteShader(reloadFragmentShader);
+    glDeleteProgram(reloadProgram);
+    reloadProgram = reloadVertexShader = reloadFragmentShader = 0;
 }
 
 void Shader::use() {
+    finish();
     glUseProgram(ID);
 }
 
+void Shader::reflectUniforms() {
+    int count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::string name(maxLength, '\0');
+    for (int i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+        std::string uniform = name.substr(0, length);
+        int location = glGetUniformLocation(ID, uniform.c_str());
+        if (location < 0)
+            continue; // Member of a uniform block
+
+        uniformLocations[uniform] = location;
+        // Arrays are reported as "name[0]"; allow setting them by plain name too
+        size_t bracket = uniform.find("[0]");
+        if (bracket != std::string::npos && bracket + 3 == uniform.size())
+            uniformLocations[uniform.substr(0, bracket)] = location;
+    }
+
+    unsigned int block = glGetUniformBlockIndex(ID, FRAME_UNIFORMS_BLOCK);
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(ID, block, FRAME_UNIFORMS_BINDING);
+}
+
+int Shader::uniformLocation(const std::string& name) const {
+    auto it = uniformLocations.find(name);
+    return it == uniformLocations.end() ? -1 : it->second;
+}
+
 void Shader::setBool(const std::string& name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(uniformLocation(name), (int)value);
 }
 
 void Shader::setInt(const std::string& name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(uniformLocation(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(uniformLocation(name), value);
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform2fv(uniformLocation(name), 1, &value[0]);
 }
 
 void Shader::setVec2(const std::string& name, float x, float y) const {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    glUniform2f(uniformLocation(name), x, y);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(uniformLocation(name), 1, &value[0]);
 }
 
 void Shader::setVec3(const std::string& name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    glUniform3f(uniformLocation(name), x, y, z);
 }
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform4fv(uniformLocation(name), 1, &value[0]);
 }
 
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    glUniform4f(uniformLocation(name), x, y, z, w);
 }
 
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::checkCompileErrors(unsigned int shader, std::string type) {
+bool Shader::checkCompileErrors(unsigned int shader, std::string type) {
     int success;
     char infoLog[1024];
     if (type != "PROGRAM") {
         glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
         if (!success) {
             glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog
-                << "\n -- --------------------------------------------------- -- " << std::endl;
+            LOG(LOG_ERROR) << "Shader compilation error of type: " << type << "\n" << infoLog
+                << "\n -- --------------------------------------------------- -- ";
         }
     }
     else {
         glGetProgramiv(shader, GL_LINK_STATUS, &success);
         if (!success) {
             glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog
-                << "\n -- --------------------------------------------------- -- " << std::endl;
+            LOG(LOG_ERROR) << "Program linking error of type: " << type << "\n" << infoLog
+                << "\n -- --------------------------------------------------- -- ";
         }
     }
+    return success != 0;
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <string>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -15,12 +16,37 @@ public:
     // Program ID
     unsigned int ID;
 
-    // Constructor reads and builds the shader
+    // Constructor reads the shader and submits its compile and link without
+    // waiting for them (see ShaderManager), unless a cached binary is loaded
     Shader(const char* vertexPath, const char* fragmentPath);
 
+    // Whether finish() would return without waiting on the driver. Needs
+    // KHR_parallel_shader_compile to find out; without it this stays false
+    // until finish().
+    bool isReady() const;
+    // Waits for the compile and link, reports errors and reads the uniforms.
+    // Called by use(), so a program is only waited for when first needed.
+    void finish();
+
+    // Hot reloading. reload() rereads the files and, if they changed, starts
+    // compiling them in the background; pollReload() then replaces ID with the
+    // new program once it is done, but only if it compiled and linked (the old
+    // program stays in use otherwise). Uniforms are looked up again after a
+    // swap; values set once outside the draw calls have to be set again.
+    enum class ReloadStatus { None, Pending, Swapped, Failed };
+    const std::string& vertexFile() const { return vertexPath; }
+    const std::string& fragmentFile() const { return fragmentPath; }
+    bool uses(const std::string& path) const;
+    bool reload();
+    ReloadStatus pollReload(bool wait = false);
+
     // Activate the shader
     void use();
 
+    // Location of an active uniform, or -1 (which glUniform* ignores) if the
+    // program has none by that name. Looked up in the table built by finish().
+    int uniformLocation(const std::string& name) const;
+
     // Utility uniform functions
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
@@ -36,8 +62,26 @@ public:
     void setMat4(const std::string& name, const glm::mat4& mat) const;
 
 private:
-    // Utility function for checking shader compilation/linking errors
-    void checkCompileErrors(unsigned int shader, std::string type);
+    std::unordered_map<std::string, int> uniformLocations;
+
+    // Compile state until finish(); the shader objects are 0 for a program
+    // loaded from the binary cache
+    bool pending = false;
+    unsigned int vertexShader = 0, fragmentShader = 0;
+    std::string cacheKey;
+
+    std::string vertexPath, fragmentPath;
+    // The program being compiled by reload(), or 0
+    unsigned int reloadProgram = 0, reloadVertexShader = 0, reloadFragmentShader = 0;
+    std::string reloadKey;
+
+    void discardReload();
+
+    // Utility function for checking shader compilation/linking errors; false on failure
+    bool checkCompileErrors(unsigned int shader, std::string type);
+    // Records the location of every active uniform and binds the FrameUniforms
+    // block, if the program uses it, to FRAME_UNIFORMS_BINDING
+    void reflectUniforms();
 };
 
 #endif // SHADER_H#pragma once
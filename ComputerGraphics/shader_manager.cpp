@@ -0,0 +1,80 @@
+#include "shader_manager.h"
+#include "logger.h"
+
+ShaderManager::ShaderManager() {
+#ifdef GL_KHR_parallel_shader_compile
+    // Let the driver pick how many compiler threads to use
+    if (parallelCompileSupported())
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+#endif
+}
+
+bool ShaderManager::parallelCompileSupported() {
+#ifdef GL_KHR_parallel_shader_compile
+    return GLAD_GL_KHR_parallel_shader_compile != 0;
+#else
+    return false;
+#endif
+}
+
+Shader& ShaderManager::load(const char* vertexPath, const char* fragmentPath) {
+    shaders.emplace_back(new Shader(vertexPath, fragmentPath));
+    if (watcher)
+        watch(vertexPath, fragmentPath);
+    return *shaders.back();
+}
+
+bool ShaderManager::allReady() const {
+    for (const auto& shader : shaders) {
+        if (!shader->isReady())
+            return false;
+    }
+    return true;
+}
+
+void ShaderManager::finishAll() {
+    for (auto& shader : shaders)
+        shader->finish();
+}
+
+void ShaderManager::enableHotReload() {
+    if (watcher)
+        return;
+    watcher.reset(new FileWatcher());
+    for (auto& shader : shaders)
+        watch(shader->vertexFile().c_str(), shader->fragmentFile().c_str());
+}
+
+void ShaderManager::watch(const char* vertexPath, const char* fragmentPath) {
+    watcher->watch(vertexPath);
+    watcher->watch(fragmentPath);
+}
+
+int ShaderManager::reloadChanged() {
+    if (!watcher)
+        return 0;
+
+    for (const std::string& path : watcher->changes()) {
+        for (auto& shader : shaders) {
+            if (shader->uses(path) && shader->reload())
+                LOG(LOG_INFO) << "Recompiling shader after change to " << path;
+        }
+    }
+
+    int swapped = 0;
+    for (auto& shader : shaders) {
+        switch (shader->pollReload()) {
+        case Shader::ReloadStatus::Swapped:
+            LOG(LOG_INFO) << "Reloaded shader " << shader->vertexFile() << " + " << shader->fragmentFile();
+            ++swapped;
+            break;
+        case Shader::ReloadStatus::Failed:
+            LOG(LOG_WARNING) << "Shader " << shader->vertexFile() << " + " << shader->fragmentFile()
+                << " failed to build; keeping the previous program";
+            break;
+        default:
+            break;
+        }
+    }
+    return swapped;
+}
@@ -0,0 +1,46 @@
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <memory>
+#include <vector>
+#include "file_watcher.h"
+#include "shader.h"
+
+// Owns the application's shaders and submits all of their compiles up front.
+// With KHR_parallel_shader_compile the driver compiles them on its own threads
+// while the application carries on (e.g. streaming in terrain); either way each
+// program is only waited for when it is first used.
+//
+// With hot reloading enabled it also watches the GLSL files: call
+// reloadChanged() once per frame and an edited program is recompiled in the
+// background and swapped in when it links (see Shader::reload()).
+class ShaderManager {
+public:
+    ShaderManager();
+
+    ShaderManager(const ShaderManager&) = delete;
+    ShaderManager& operator=(const ShaderManager&) = delete;
+
+    // Submits a program; the reference stays valid for the manager's lifetime
+    Shader& load(const char* vertexPath, const char* fragmentPath);
+
+    bool allReady() const;
+    // Waits for every program still compiling
+    void finishAll();
+
+    static bool parallelCompileSupported();
+
+    // Starts watching the files of every program, loaded or still to come
+    void enableHotReload();
+    // Starts recompiling programs whose files changed and swaps in those that
+    // finished. Returns how many programs were replaced.
+    int reloadChanged();
+
+private:
+    std::vector<std::unique_ptr<Shader>> shaders;
+    std::unique_ptr<FileWatcher> watcher;
+
+    void watch(const char* vertexPath, const char* fragmentPath);
+};
+
+#endif // SHADER_MANAGER_H
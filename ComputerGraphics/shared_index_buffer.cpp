@@ -0,0 +1,55 @@
+#include "shared_index_buffer.h"
+#include <map>
+#include <tuple>
+
+namespace {
+
+typedef std::tuple<int, int, int> Key; // width, depth, layout
+
+// Weak references, so a buffer goes away with the last mesh using it rather
+// than outliving the GL context at static destruction
+std::map<Key, std::weak_ptr<SharedIndexBuffer>>& registry() {
+    static std::map<Key, std::weak_ptr<SharedIndexBuffer>> buffers;
+    return buffers;
+}
+
+int liveCount = 0;
+size_t liveSize = 0;
+
+} // namespace
+
+std::shared_ptr<SharedIndexBuffer> SharedIndexBuffer::acquire(int width, int depth, Grid_Index_Layout layout) {
+    std::weak_ptr<SharedIndexBuffer>& entry = registry()[Key(width, depth, layout)];
+    std::shared_ptr<SharedIndexBuffer> buffer = entry.lock();
+    if (!buffer) {
+        buffer.reset(new SharedIndexBuffer(width, depth, layout));
+        entry = buffer;
+    }
+    return buffer;
+}
+
+int SharedIndexBuffer::liveBuffers() {
+    return liveCount;
+}
+
+size_t SharedIndexBuffer::liveBytes() {
+    return liveSize;
+}
+
+SharedIndexBuffer::SharedIndexBuffer(int width, int depth, Grid_Index_Layout layout)
+    : indices(width, depth, layout) {
+    glGenBuffers(1, &EBO);
+    // Bound as an array buffer so no VAO's element array binding is disturbed
+    glBindBuffer(GL_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ARRAY_BUFFER, indices.byteSize(), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    liveCount++;
+    liveSize += indices.byteSize();
+}
+
+SharedIndexBuffer::~SharedIndexBuffer() {
+    glDeleteBuffers(1, &EBO);
+    liveCount--;
+    liveSize -= indices.byteSize();
+}
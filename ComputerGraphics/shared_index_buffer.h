@@ -0,0 +1,46 @@
+#ifndef SHARED_INDEX_BUFFER_H
+#define SHARED_INDEX_BUFFER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <memory>
+#include "grid_indices.h"
+
+// Element buffer holding the indices of one grid resolution and layout. Every
+// grid with the same dimensions draws the same index pattern, so all terrain
+// chunks (and the heightmap renderer's mesh) of a resolution share a single
+// buffer: acquire() hands out the live one, and it is deleted when the last
+// mesh holding it lets go. There are no LOD stitching variants to key on, as
+// neighbouring levels are joined by morphing heights, not by extra triangles.
+//
+// GL thread only.
+class SharedIndexBuffer {
+public:
+    // Returns the buffer for a width x depth-quad grid in layout, generating and
+    // uploading it if no mesh holds one yet
+    static std::shared_ptr<SharedIndexBuffer> acquire(int width, int depth, Grid_Index_Layout layout);
+
+    // Buffers currently alive and the GPU memory they take
+    static int liveBuffers();
+    static size_t liveBytes();
+
+    ~SharedIndexBuffer();
+
+    SharedIndexBuffer(const SharedIndexBuffer&) = delete;
+    SharedIndexBuffer& operator=(const SharedIndexBuffer&) = delete;
+
+    const GridIndices& getIndices() const { return indices; }
+
+    // Makes this the element array of the bound VAO
+    void bind() const { glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO); }
+    // Draws with the bound VAO, which must have this buffer bound
+    void draw(int instances = 1) const { indices.draw(instances); }
+
+private:
+    SharedIndexBuffer(int width, int depth, Grid_Index_Layout layout);
+
+    GridIndices indices;
+    unsigned int EBO = 0;
+};
+
+#endif // SHARED_INDEX_BUFFER_H
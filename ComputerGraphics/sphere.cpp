@@ -5,9 +5,10 @@ Sphere::Sphere(float radius, unsigned int sectorCount, unsigned int stackCount)
     initSphere(radius, sectorCount, stackCount);
 }
 
-void Sphere::initSphere(float radius, unsigned int sectorCount, unsigned int stackCount) {
-    std::vector<glm::vec3> vertices;
-    std::vector<unsigned int> indices;
+void Sphere::generateMesh(float radius, unsigned int sectorCount, unsigned int stackCount,
+    std::vector<glm::vec3>& vertices, std::vector<unsigned int>& indices) {
+    vertices.clear();
+    indices.clear();
 
     float x, y, z, xy;                              // vertex position
     float sectorStep = 2 * glm::pi<float>() / sectorCount;
@@ -48,6 +49,12 @@ void Sphere::initSphere(float radius, unsigned int sectorCount, unsigned int sta
             }
         }
     }
+}
+
+void Sphere::initSphere(float radius, unsigned int sectorCount, unsigned int stackCount) {
+    std::vector<glm::vec3> vertices;
+    std::vector<unsigned int> indices;
+    generateMesh(radius, sectorCount, stackCount, vertices, indices);
 
     // Generate buffers
     indexCount = indices.size();
@@ -2,6 +2,7 @@
 #define SPHERE_H
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
 #include <vector>
 #include <iostream>
 
@@ -10,6 +11,10 @@ public:
     Sphere(float radius, unsigned int sectorCount, unsigned int stackCount);
     void Draw(unsigned int shaderID);
 
+    // Builds the vertex positions and triangle indices of a UV sphere (CPU only)
+    static void generateMesh(float radius, unsigned int sectorCount, unsigned int stackCount,
+        std::vector<glm::vec3>& vertices, std::vector<unsigned int>& indices);
+
 private:
     unsigned int VAO, VBO, EBO;
     unsigned int indexCount;
@@ -1,13 +1,121 @@
 #include "terrain.h"
 #include "perlin.h"
+#include "parallel.h"
 #include <random>
 #include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <glm/gtc/constants.hpp>
+
+// Noise parameters
+const int octaves = 6; // Reduced octaves for less noise detail
+const float meshHeight = 15; // Vertical scaling for mountains
+const float noiseScale = 1000; // Horizontal scaling
+const float persistence = 0.5f;
+const float lacunarity = 2.0f;
 
 Terrain::Terrain(int width, int depth, float scale) {
-    generateTerrain(width, depth, scale);
+    generateTerrain(width, depth, scale, NoiseContext(std::random_device()()));
     setupBuffers(); // Add this call to set up OpenGL buffers after terrain generation
 }
 
+Terrain::Terrain(int width, int depth, float scale, int originX, int originZ, const NoiseContext& noise)
+    : originX(originX), originZ(originZ) {
+    generateTerrain(width, depth, scale, noise);
+}
+
+Terrain::Terrain(int width, int depth, float scale, int originX, int originZ,
+    const float* heights, const float* normalsXZ)
+    : originX(originX), originZ(originZ), gridWidth(width), gridDepth(depth), gridScale(scale) {
+    int rowLength = width + 1;
+    vertices.resize(rowLength * (depth + 1) * VertexFloats);
+    parallelFor(0, depth + 1, [&](int zBegin, int zEnd) {
+        for (int z = zBegin; z < zEnd; ++z) {
+            for (int x = 0; x <= width; ++x) {
+                int i = x + z * rowLength;
+                float nx = normalsXZ[i * 2], nz = normalsXZ[i * 2 + 1];
+                glm::vec3 normal(nx, std::sqrt(std::max(1.0f - nx * nx - nz * nz, 0.0f)), nz);
+                setVertex(x, z, heights[i], normal);
+            }
+        }
+    });
+    buildMesh();
+}
+
+const float Terrain::CompactHeightStep = 0.5f;
+
+Terrain::~Terrain() {
+    releaseBuffers();
+}
+
+void Terrain::releaseBuffers() {
+    if (isUploaded()) {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        VAO = VBO = 0;
+        indexBuffer.reset();
+    }
+}
+
+float Terrain::heightBound() {
+    // Improved Perlin noise stays within about +-1.04, so 1.1 per octave is safe
+    float maxNoise = 0;
+    float amp = 1;
+    for (int i = 0; i < octaves; i++) {
+        maxNoise += 1.1f * amp;
+        amp *= persistence;
+    }
+    return std::pow(maxNoise * meshHeight, 3.0f);
+}
+
+void Terrain::upload(Terrain_Vertex_Format format) {
+    if (isUploaded() && format == vertexFormat) {
+        if (dirtyBegin < dirtyEnd)
+            updateBuffers(dirtyBegin, dirtyEnd);
+    }
+    else {
+        releaseBuffers();
+        vertexFormat = format;
+        if (format != TERRAIN_VERTEX_HEIGHTMAP)
+            setupBuffers();
+    }
+    dirtyBegin = dirtyEnd = 0;
+}
+
+std::vector<Terrain::CompactVertex> Terrain::packCompactVertices(int zBegin, int zEnd) {
+    auto quantize = [this](float h) {
+        // Heights more than 65535 steps above the base (far beyond anything the
+        // noise produces) are clamped
+        float steps = std::round((h - heightBase) / CompactHeightStep);
+        return static_cast<unsigned short>(std::min(std::max(steps, 0.0f), 65535.0f));
+    };
+
+    int rowLength = gridWidth + 1;
+    std::vector<CompactVertex> packed((zEnd - zBegin) * rowLength);
+    for (int i = zBegin * rowLength; i < zEnd * rowLength; ++i) {
+        const float* v = &vertices[i * VertexFloats];
+        CompactVertex& c = packed[i - zBegin * rowLength];
+        c.gridX = static_cast<unsigned short>(i % (gridWidth + 1));
+        c.gridZ = static_cast<unsigned short>(i / (gridWidth + 1));
+        c.height = quantize(v[1]);
+        c.morphHeight = quantize(v[8]);
+
+        // Octahedral encoding around +y: project onto the octahedron, fold the
+        // lower half over the diagonals, store x and z as 8-bit snorm
+        glm::vec3 n(v[3], v[4], v[5]);
+        n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        glm::vec2 e(n.x, n.z);
+        if (n.y < 0) {
+            e = glm::vec2((1.0f - std::abs(n.z)) * (n.x >= 0 ? 1.0f : -1.0f),
+                (1.0f - std::abs(n.x)) * (n.z >= 0 ? 1.0f : -1.0f));
+        }
+        c.normal[0] = static_cast<signed char>(std::round(glm::clamp(e.x, -1.0f, 1.0f) * 127.0f));
+        c.normal[1] = static_cast<signed char>(std::round(glm::clamp(e.y, -1.0f, 1.0f) * 127.0f));
+        c.padding = 0;
+    }
+    return packed;
+}
+
 void Terrain::setupBuffers() {
     // This method sets up the OpenGL buffers for the terrain
     // Note: This is essentially moving the buffer creation code from generateTerrain
@@ -16,124 +124,423 @@ void Terrain::setupBuffers() {
     // Create OpenGL buffers
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
 
     glBindVertexArray(VAO);
 
-    // Vertex buffer
+    // Element buffer, generated and uploaded only by the first terrain of this size
+    indexBuffer = SharedIndexBuffer::acquire(gridWidth, gridDepth, TERRAIN_INDEX_LAYOUT);
+    indexBuffer->bind();
+
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    if (vertexFormat == TERRAIN_VERTEX_COMPACT) {
+        heightBase = std::floor(boundsMin.y / CompactHeightStep) * CompactHeightStep;
+        std::vector<CompactVertex> packed = packCompactVertices(0, gridDepth + 1);
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(CompactVertex), packed.data(), GL_STATIC_DRAW);
+
+        // Grid coordinate attribute (converted to float as-is)
+        glVertexAttribPointer(4, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, gridX));
+        glEnableVertexAttribArray(4);
 
-    // Element buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        // Height and morph target height attribute, in height steps
+        glVertexAttribPointer(5, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, height));
+        glEnableVertexAttribArray(5);
 
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+        // Octahedral normal attribute
+        glVertexAttribPointer(6, 2, GL_BYTE, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, normal));
+        glEnableVertexAttribArray(6);
+    }
+    else {
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+
+        // Position attribute
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VertexFloats * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        // Normal attribute
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, VertexFloats * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
 
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+        // Texture coordinate attribute
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, VertexFloats * sizeof(float), (void*)(6 * sizeof(float)));
+        glEnableVertexAttribArray(2);
 
-    // Texture coordinate attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+        // LOD morph target height attribute
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, VertexFloats * sizeof(float), (void*)(8 * sizeof(float)));
+        glEnableVertexAttribArray(3);
+    }
 
     // Unbind buffers
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
 
-void Terrain::generateTerrain(int width, int depth, float scale) {
+void Terrain::updateBuffers(int zBegin, int zEnd) {
+    size_t rowLength = gridWidth + 1;
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    if (vertexFormat == TERRAIN_VERTEX_COMPACT) {
+        // Heights are stored as steps above heightBase; an edit below it moves
+        // the base and so changes every vertex
+        if (boundsMin.y < heightBase) {
+            heightBase = std::floor(boundsMin.y / CompactHeightStep) * CompactHeightStep;
+            zBegin = 0;
+            zEnd = gridDepth + 1;
+        }
+        std::vector<CompactVertex> packed = packCompactVertices(zBegin, zEnd);
+        glBufferSubData(GL_ARRAY_BUFFER, zBegin * rowLength * sizeof(CompactVertex),
+            packed.size() * sizeof(CompactVertex), packed.data());
+    }
+    else {
+        size_t rowFloats = rowLength * VertexFloats;
+        glBufferSubData(GL_ARRAY_BUFFER, zBegin * rowFloats * sizeof(float),
+            (zEnd - zBegin) * rowFloats * sizeof(float), &vertices[zBegin * rowFloats]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Terrain::generateTerrain(int width, int depth, float scale, const NoiseContext& p) {
     // Clear any existing data
     vertices.clear();
-    indices.clear();
-
-    // Noise parameters
-    int octaves = 6; // Reduced octaves for less noise detail
-    float meshHeight = 15; // Vertical scaling for mountains
-    float noiseScale = 1000; // Horizontal scaling
-    float persistence = 0.5f;
-    float lacunarity = 2.0f;
-
-    std::vector<float> noiseValues;
-    std::vector<int> p = get_permutation_vector();
-    float maxPossibleHeight = 0;
-    float amp = 15.0f;
-    float freq = 15.0f;
-
-    // Calculate the max possible height
-    for (int i = 0; i < octaves; i++) {
-        maxPossibleHeight += amp;
-        amp *= persistence;
-    }
+    gridWidth = width;
+    gridDepth = depth;
+    gridScale = scale;
+
+    std::vector<float> noiseValues, noiseSlopeX, noiseSlopeZ;
 
-    // Generate Perlin noise values
-    for (int z = 0; z <= depth; ++z) {
-        for (int x = 0; x <= width; ++x) {
-            amp = 1;
-            freq = 1;
-            float noiseHeight = 0;
+    // Generate Perlin noise values, one row per batch so the SIMD kernel
+    // evaluates several samples of an octave at once. Rows are split into
+    // bands across threads; every row only depends on its own z, so the
+    // result is the same as a single-threaded pass. Samples are taken at
+    // world grid coordinates so neighbouring terrains line up at their edges.
+    // The noise's analytic derivatives come out of the same evaluation and
+    // are summed into its slope along world x and z.
+    int rowLength = width + 1;
+    noiseValues.assign(rowLength * (depth + 1), 0.0f);
+    noiseSlopeX.assign(rowLength * (depth + 1), 0.0f);
+    noiseSlopeZ.assign(rowLength * (depth + 1), 0.0f);
+    parallelFor(0, depth + 1, [&](int zBegin, int zEnd) {
+        std::vector<float> xSamples(rowLength), zSamples(rowLength), octaveValues(rowLength),
+            octaveDx(rowLength), octaveDz(rowLength);
+        for (int z = zBegin; z < zEnd; ++z) {
+            float* noiseRow = &noiseValues[z * rowLength];
+            float* slopeXRow = &noiseSlopeX[z * rowLength];
+            float* slopeZRow = &noiseSlopeZ[z * rowLength];
+            float amp = 1;
+            float freq = 1;
             for (int i = 0; i < octaves; i++) {
-                float xSample = (x * scale) / noiseScale * freq;
-                float zSample = (z * scale) / noiseScale * freq;
-                double perlinValue = perlin_noise(xSample, zSample, 0.5, p); // Pass z as 0.5 for 2D noise
-                noiseHeight += perlinValue * amp;
+                for (int x = 0; x <= width; ++x) {
+                    xSamples[x] = ((originX + x) * scale) / noiseScale * freq;
+                    zSamples[x] = ((originZ + z) * scale) / noiseScale * freq;
+                }
+                perlin_noise_batch_deriv(xSamples.data(), zSamples.data(), 0.5f, octaveValues.data(),
+                    octaveDx.data(), octaveDz.data(), rowLength, p); // Pass z as 0.5 for 2D noise
+                // d(sample)/d(world position) = freq / noiseScale
+                float slopeScale = amp * freq / noiseScale;
+                for (int x = 0; x <= width; ++x) {
+                    noiseRow[x] += octaveValues[x] * amp;
+                    slopeXRow[x] += octaveDx[x] * slopeScale;
+                    slopeZRow[x] += octaveDz[x] * slopeScale;
+                }
                 amp *= persistence;
                 freq *= lacunarity;
             }
-            noiseValues.push_back(noiseHeight);
         }
-    }
+    });
 
     // Normalize the noise values and generate vertices
-    for (int z = 0; z <= depth; ++z) {
-        for (int x = 0; x <= width; ++x) {
-            float posX = x * scale;
-            float posZ = z * scale;
-            float height = noiseValues[x + z * (width + 1)] * meshHeight;
-
-            // Apply a transformation to create more varied terrain
-            height = std::pow(height, 3.0f); // Exaggerate the height difference
-
-            // Vertex data: position (x, y, z), normal, texture coordinates
-            vertices.push_back(posX);
-            vertices.push_back(height);
-            vertices.push_back(posZ);
-
-            // Normal (simplified)
-            vertices.push_back(0.0f);
-            vertices.push_back(1.0f);
-            vertices.push_back(0.0f);
-
-            // Texture coordinates
-            vertices.push_back(static_cast<float>(x) / width);
-            vertices.push_back(static_cast<float>(z) / depth);
+    vertices.resize(rowLength * (depth + 1) * VertexFloats);
+    parallelFor(0, depth + 1, [&](int zBegin, int zEnd) {
+        for (int z = zBegin; z < zEnd; ++z) {
+            for (int x = 0; x <= width; ++x) {
+                float height = noiseValues[x + z * rowLength] * meshHeight;
+
+                // Slope of the rendered surface: d/dn (n * meshHeight)^3 is
+                // 3 (n * meshHeight)^2 * meshHeight, and the vertex shader
+                // scales heights by TERRAIN_HEIGHT_SCALE
+                float slope = 3.0f * height * height * meshHeight * TERRAIN_HEIGHT_SCALE;
+                glm::vec3 normal = glm::normalize(glm::vec3(-slope * noiseSlopeX[x + z * rowLength], 1.0f,
+                    -slope * noiseSlopeZ[x + z * rowLength]));
+
+                // Apply a transformation to create more varied terrain
+                height = std::pow(height, 3.0f); // Exaggerate the height difference
+                setVertex(x, z, height, normal);
+            }
+        }
+    });
+
+    buildMesh();
+}
+
+void Terrain::setVertex(int x, int z, float height, const glm::vec3& normal) {
+    // Vertex data: position (x, y, z), normal, texture coordinates
+    float* v = &vertices[(x + z * (gridWidth + 1)) * VertexFloats];
+    v[0] = (originX + x) * gridScale;
+    v[1] = height;
+    v[2] = (originZ + z) * gridScale;
+
+    v[3] = normal.x;
+    v[4] = normal.y;
+    v[5] = normal.z;
+
+    // Texture coordinates
+    v[6] = static_cast<float>(x) / gridWidth;
+    v[7] = static_cast<float>(z) / gridDepth;
+}
+
+void Terrain::buildMesh() {
+    int width = gridWidth, depth = gridDepth;
+    int rowLength = width + 1;
+
+    // Bounding box, from each row's height range
+    std::vector<float> rowMin(depth + 1), rowMax(depth + 1);
+    parallelFor(0, depth + 1, [&](int zBegin, int zEnd) {
+        for (int z = zBegin; z < zEnd; ++z) {
+            rowMin[z] = rowMax[z] = vertexHeight(0, z);
+            for (int x = 1; x <= width; ++x) {
+                rowMin[z] = std::min(rowMin[z], vertexHeight(x, z));
+                rowMax[z] = std::max(rowMax[z], vertexHeight(x, z));
+            }
+        }
+    });
+    boundsMin = glm::vec3(originX * gridScale, *std::min_element(rowMin.begin(), rowMin.end()), originZ * gridScale);
+    boundsMax = glm::vec3((originX + width) * gridScale, *std::max_element(rowMax.begin(), rowMax.end()),
+        (originZ + depth) * gridScale);
+
+    // Morph targets; the vertex shader blends toward them so LOD switches don't pop
+    parallelFor(0, depth + 1, [&](int zBegin, int zEnd) {
+        for (int z = zBegin; z < zEnd; ++z) {
+            for (int x = 0; x <= width; ++x)
+                vertices[(x + z * rowLength) * VertexFloats + 8] = morphTarget(x, z);
         }
+    });
+
+    heightTree.build(width, depth, &vertices[1], VertexFloats);
+}
+
+float Terrain::morphTarget(int x, int z) const {
+    // Interpolated along the coarse triangle the vertex falls on
+    bool oddX = (x & 1) && x < gridWidth;
+    bool oddZ = (z & 1) && z < gridDepth;
+    if (oddX && oddZ) // Centre of a coarse quad, on its (x+1, z-1)-(x-1, z+1) diagonal
+        return 0.5f * (vertexHeight(x + 1, z - 1) + vertexHeight(x - 1, z + 1));
+    if (oddX)
+        return 0.5f * (vertexHeight(x - 1, z) + vertexHeight(x + 1, z));
+    if (oddZ)
+        return 0.5f * (vertexHeight(x, z - 1) + vertexHeight(x, z + 1));
+    return vertexHeight(x, z);
+}
+
+bool Terrain::edit(const TerrainBrush& brush) {
+    if (brush.radius <= 0.0f)
+        return false;
+
+    // Vertices inside the brush's bounding square
+    int x0 = std::max(static_cast<int>(std::ceil((brush.x - brush.radius) / gridScale)) - originX, 0);
+    int x1 = std::min(static_cast<int>(std::floor((brush.x + brush.radius) / gridScale)) - originX, gridWidth);
+    int z0 = std::max(static_cast<int>(std::ceil((brush.z - brush.radius) / gridScale)) - originZ, 0);
+    int z1 = std::min(static_cast<int>(std::floor((brush.z + brush.radius) / gridScale)) - originZ, gridDepth);
+    if (x0 > x1 || z0 > z1)
+        return false;
+
+    // Old heights of the square and the ring of vertices around it, whose
+    // normals and morph targets depend on the square's heights
+    int rx0 = std::max(x0 - 1, 0), rx1 = std::min(x1 + 1, gridWidth);
+    int rz0 = std::max(z0 - 1, 0), rz1 = std::min(z1 + 1, gridDepth);
+    int oldWidth = rx1 - rx0 + 1;
+    std::vector<float> old(oldWidth * (rz1 - rz0 + 1));
+    for (int z = rz0; z <= rz1; ++z) {
+        for (int x = rx0; x <= rx1; ++x)
+            old[(x - rx0) + (z - rz0) * oldWidth] = vertexHeight(x, z);
     }
+    auto oldHeight = [&](int x, int z) { return old[(x - rx0) + (z - rz0) * oldWidth]; };
+    auto setHeight = [&](int x, int z, float h) { vertices[(x + z * (gridWidth + 1)) * VertexFloats + 1] = h; };
+
+    // Brush weight at a vertex, fading from 1 at the centre to 0 at the
+    // radius, and its gradient along world x and z
+    auto falloffAt = [&](int x, int z, glm::vec2& gradient) {
+        glm::vec2 offset((originX + x) * gridScale - brush.x, (originZ + z) * gridScale - brush.z);
+        float distance = glm::length(offset);
+        gradient = glm::vec2(0.0f);
+        if (distance >= brush.radius)
+            return 0.0f;
+        float angle = glm::pi<float>() * distance / brush.radius;
+        if (distance > 0.0f)
+            gradient = offset / distance * (-0.5f * glm::pi<float>() / brush.radius * std::sin(angle));
+        return 0.5f + 0.5f * std::cos(angle);
+    };
 
-    // Generate indices
-    for (int z = 0; z < depth; ++z) {
-        for (int x = 0; x < width; ++x) {
-            unsigned int current = z * (width + 1) + x;
-            unsigned int next = current + width + 1;
+    float blend = std::min(std::max(brush.strength, 0.0f), 1.0f);
+    bool changed = false;
+    for (int z = z0; z <= z1; ++z) {
+        for (int x = x0; x <= x1; ++x) {
+            glm::vec2 gradient;
+            float falloff = falloffAt(x, z, gradient);
+            if (falloff == 0.0f)
+                continue;
+
+            float h = oldHeight(x, z);
+            switch (brush.mode) {
+            case TERRAIN_BRUSH_RAISE:
+                h += brush.strength * falloff;
+                break;
+            case TERRAIN_BRUSH_LOWER:
+                h -= brush.strength * falloff;
+                break;
+            case TERRAIN_BRUSH_FLATTEN:
+                h += (brush.targetHeight - h) * blend * falloff;
+                break;
+            case TERRAIN_BRUSH_SMOOTH: {
+                // The neighbouring terrain only has an edge vertex's neighbours
+                // along the edge, so average just those to match its copy, and
+                // leave corners, shared by up to four terrains, alone
+                bool edgeX = x == 0 || x == gridWidth;
+                bool edgeZ = z == 0 || z == gridDepth;
+                float average;
+                if (edgeX && edgeZ)
+                    break;
+                else if (edgeX)
+                    average = 0.5f * (oldHeight(x, z - 1) + oldHeight(x, z + 1));
+                else if (edgeZ)
+                    average = 0.5f * (oldHeight(x - 1, z) + oldHeight(x + 1, z));
+                else
+                    average = 0.25f * (oldHeight(x - 1, z) + oldHeight(x + 1, z) + oldHeight(x, z - 1) + oldHeight(x, z + 1));
+                h += (average - h) * blend * falloff;
+                break;
+            }
+            }
+            if (h != oldHeight(x, z)) {
+                setHeight(x, z, h);
+                boundsMin.y = std::min(boundsMin.y, h);
+                boundsMax.y = std::max(boundsMax.y, h);
+                changed = true;
+            }
+        }
+    }
+    if (!changed)
+        return false;
 
-            indices.push_back(current);
-            indices.push_back(next);
-            indices.push_back(current + 1);
+    // Normals: add the slope of the height change to each vertex's slope, which
+    // keeps the analytic normals of the generated surface elsewhere. Inside the
+    // terrain the change's slope is a central difference. Across its edges the
+    // other neighbour belongs to another terrain, so it comes from the brush's
+    // own gradient instead, which both copies of an edge vertex agree on.
+    auto change = [&](int x, int z) {
+        bool edited = x >= x0 && x <= x1 && z >= z0 && z <= z1;
+        return edited ? vertexHeight(x, z) - oldHeight(x, z) : 0.0f;
+    };
+    auto brushSlope = [&](int x, int z, float heightSlope, int axis) {
+        glm::vec2 gradient;
+        float falloff = falloffAt(x, z, gradient);
+        if (falloff == 0.0f)
+            return 0.0f;
+        switch (brush.mode) {
+        case TERRAIN_BRUSH_RAISE:
+            return brush.strength * gradient[axis];
+        case TERRAIN_BRUSH_LOWER:
+            return -brush.strength * gradient[axis];
+        case TERRAIN_BRUSH_FLATTEN: // d/dx ((target - h) * blend * falloff)
+            return change(x, z) / falloff * gradient[axis] - blend * falloff * heightSlope;
+        default: // Smoothing leaves the slope of the average about that of the height
+            return change(x, z) / falloff * gradient[axis];
+        }
+    };
+    for (int z = rz0; z <= rz1; ++z) {
+        for (int x = rx0; x <= rx1; ++x) {
+            // normal = normalize(-slopeX, 1, -slopeZ) for the rendered surface,
+            // whose heights are scaled by TERRAIN_HEIGHT_SCALE
+            float* v = &vertices[(x + z * (gridWidth + 1)) * VertexFloats];
+            glm::vec2 slope(-v[3] / v[4], -v[5] / v[4]);
+            glm::vec2 changeSlope;
+            if (x == 0 || x == gridWidth)
+                changeSlope.x = brushSlope(x, z, slope.x / TERRAIN_HEIGHT_SCALE, 0);
+            else
+                changeSlope.x = (change(x + 1, z) - change(x - 1, z)) / (2.0f * gridScale);
+            if (z == 0 || z == gridDepth)
+                changeSlope.y = brushSlope(x, z, slope.y / TERRAIN_HEIGHT_SCALE, 1);
+            else
+                changeSlope.y = (change(x, z + 1) - change(x, z - 1)) / (2.0f * gridScale);
+            if (changeSlope == glm::vec2(0.0f))
+                continue;
 
-            indices.push_back(current + 1);
-            indices.push_back(next);
-            indices.push_back(next + 1);
+            slope += changeSlope * TERRAIN_HEIGHT_SCALE;
+            glm::vec3 normal = glm::normalize(glm::vec3(-slope.x, 1.0f, -slope.y));
+            v[3] = normal.x;
+            v[4] = normal.y;
+            v[5] = normal.z;
         }
     }
 
-    indexCount = indices.size();
+    for (int z = rz0; z <= rz1; ++z) {
+        for (int x = rx0; x <= rx1; ++x)
+            vertices[(x + z * (gridWidth + 1)) * VertexFloats + 8] = morphTarget(x, z);
+    }
+    // Quads with a corner in the edited square
+    heightTree.update(rx0, rz0, rx1, rz1, &vertices[1], VertexFloats);
+
+    if (dirtyBegin < dirtyEnd) {
+        dirtyBegin = std::min(dirtyBegin, rz0);
+        dirtyEnd = std::max(dirtyEnd, rz1 + 1);
+    }
+    else {
+        dirtyBegin = rz0;
+        dirtyEnd = rz1 + 1;
+    }
+    return true;
+}
+
+bool Terrain::heightAt(float x, float z, float& height) const {
+    float gridX = x / gridScale - originX, gridZ = z / gridScale - originZ;
+    if (gridX < 0.0f || gridX > gridWidth || gridZ < 0.0f || gridZ > gridDepth)
+        return false;
+    height = heightTree.heightAt(gridX, gridZ, &vertices[1], VertexFloats) * TERRAIN_HEIGHT_SCALE;
+    return true;
+}
+
+bool Terrain::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& t) const {
+    // The same ray in grid space, where t is unchanged
+    glm::vec3 scale(1.0f / gridScale, 1.0f / TERRAIN_HEIGHT_SCALE, 1.0f / gridScale);
+    glm::vec3 gridOrigin = origin * scale - glm::vec3(originX, 0.0f, originZ);
+    return heightTree.raycast(gridOrigin, direction * scale, maxDistance, &vertices[1], VertexFloats, t);
+}
+
+std::vector<float> Terrain::getNormalsXZ() const {
+    return getNormalsXZ(0, gridDepth + 1);
+}
+
+std::vector<float> Terrain::getNormalsXZ(int zBegin, int zEnd) const {
+    size_t first = static_cast<size_t>(zBegin) * (gridWidth + 1);
+    std::vector<float> normals((zEnd - zBegin) * (gridWidth + 1) * 2);
+    for (size_t i = 0; i < normals.size() / 2; ++i) {
+        normals[i * 2] = vertices[(first + i) * VertexFloats + 3];
+        normals[i * 2 + 1] = vertices[(first + i) * VertexFloats + 5];
+    }
+    return normals;
+}
+
+std::vector<float> Terrain::getHeights() const {
+    return getHeights(0, gridDepth + 1);
+}
+
+std::vector<float> Terrain::getHeights(int zBegin, int zEnd) const {
+    size_t first = static_cast<size_t>(zBegin) * (gridWidth + 1);
+    std::vector<float> heights((zEnd - zBegin) * (gridWidth + 1));
+    for (size_t i = 0; i < heights.size(); ++i)
+        heights[i] = vertices[(first + i) * VertexFloats + 1];
+    return heights;
 }
 
 void Terrain::Draw(Shader& shader) {
+    if (!isUploaded())
+        return;
+
+    shader.setInt("vertexFormat", vertexFormat);
+    if (vertexFormat == TERRAIN_VERTEX_COMPACT) {
+        shader.setVec2("gridOrigin", static_cast<float>(originX), static_cast<float>(originZ));
+        shader.setVec2("gridSize", static_cast<float>(gridWidth), static_cast<float>(gridDepth));
+        shader.setFloat("gridScale", gridScale);
+        shader.setVec2("heightQuantization", heightBase, CompactHeightStep);
+    }
+
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    indexBuffer->draw();
     glBindVertexArray(0);
 }
\ No newline at end of file
@@ -3,23 +3,162 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <memory>
 #include <vector>
 #include "shader.h"
+#include "shared_index_buffer.h"
+#include "height_quadtree.h"
+
+class NoiseContext;
+
+// Vertical scale terrain_vertex.glsl applies to heights before rendering
+const float TERRAIN_HEIGHT_SCALE = 0.2f;
+
+// Index order of every terrain grid (chunks and the heightmap renderer's mesh)
+const Grid_Index_Layout TERRAIN_INDEX_LAYOUT = GRID_INDEX_STRIPS;
+
+// Layout of the terrain vertex buffer
+enum Terrain_Vertex_Format {
+    TERRAIN_VERTEX_FULL,    // 9 floats: position, normal, texture coordinates, morph height (36 bytes)
+    TERRAIN_VERTEX_COMPACT, // Quantized: 16-bit grid XZ and heights, octahedral 2x8-bit normal (12 bytes)
+    TERRAIN_VERTEX_HEIGHTMAP // No vertex buffer: heights live in a texture and a shared grid mesh is
+                             // instanced over them (see HeightmapRenderer)
+};
+
+// What a TerrainBrush does to the heights it covers
+enum Terrain_Brush_Mode {
+    TERRAIN_BRUSH_RAISE,
+    TERRAIN_BRUSH_LOWER,
+    TERRAIN_BRUSH_FLATTEN, // Toward targetHeight
+    TERRAIN_BRUSH_SMOOTH   // Toward the average of each vertex's neighbours
+};
+
+// Circular height edit around world (x, z). Its effect fades smoothly from full
+// at the centre to nothing at radius. Heights are before TERRAIN_HEIGHT_SCALE.
+struct TerrainBrush {
+    Terrain_Brush_Mode mode = TERRAIN_BRUSH_RAISE;
+    float x = 0.0f, z = 0.0f;
+    float radius = 1.0f;
+    // Raise and lower: height added or removed at the centre. Flatten and
+    // smooth: fraction of the way to the target moved at the centre (0 to 1).
+    float strength = 1.0f;
+    float targetHeight = 0.0f;
+};
 
 class Terrain {
 public:
+    // Bump whenever generation changes what a given seed produces; tiles
+    // cached by an older version are then regenerated (see TileCache)
+    static const unsigned int GeneratorVersion = 1;
+
     Terrain(int width, int depth, float scale);
+
+    // Generates the grid cell range [originX, originX + width] x [originZ, originZ + depth]
+    // of an endless heightfield shared by every terrain built from the same noise context.
+    // Only CPU data is produced, so this is safe to call from a worker thread; call
+    // upload() on the GL thread before drawing.
+    Terrain(int width, int depth, float scale, int originX, int originZ, const NoiseContext& noise);
+    // Rebuilds a terrain from the output of getHeights() and getNormalsXZ()
+    // (e.g. loaded from a TileCache) without evaluating any noise
+    Terrain(int width, int depth, float scale, int originX, int originZ,
+        const float* heights, const float* normalsXZ);
+    ~Terrain();
+
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+
+    // Creates the OpenGL buffers from the generated data in the given layout,
+    // rebuilding them if they were uploaded in another one, or else updates
+    // the rows changed by edit() since the last upload (GL thread only).
+    // TERRAIN_VERTEX_HEIGHTMAP frees the buffers; the heights are uploaded by
+    // a HeightmapRenderer instead.
+    void upload(Terrain_Vertex_Format format = TERRAIN_VERTEX_FULL);
+    bool isUploaded() const { return VAO != 0; }
+
     void Draw(Shader& shader);
 
+    // Applies a brush to the vertices it covers and updates their normals and
+    // LOD morph targets; returns whether any height changed. Only the rows it
+    // touched are sent by the next upload(). Edge vertices change exactly as
+    // the neighbouring terrain's copies do, so edits across terrains never crack.
+    bool edit(const TerrainBrush& brush);
+    // Rows [begin, end) changed by edit() since the last upload(); empty if none
+    int dirtyRowsBegin() const { return dirtyBegin; }
+    int dirtyRowsEnd() const { return dirtyEnd; }
+
+    // Heights of the (width + 1) x (depth + 1) vertices, row by row
+    std::vector<float> getHeights() const;
+    std::vector<float> getHeights(int zBegin, int zEnd) const;
+    // x and z of the (width + 1) x (depth + 1) vertex normals, interleaved row
+    // by row; y is sqrt(1 - x^2 - z^2), as a heightfield's normals point up
+    std::vector<float> getNormalsXZ() const;
+    std::vector<float> getNormalsXZ(int zBegin, int zEnd) const;
+    int getOriginX() const { return originX; }
+    int getOriginZ() const { return originZ; }
+    int getGridWidth() const { return gridWidth; }
+    int getGridDepth() const { return gridDepth; }
+    float getGridScale() const { return gridScale; }
+
+    // Height of the rendered surface at world (x, z), scaled by
+    // TERRAIN_HEIGHT_SCALE and without LOD morphing; false off the terrain
+    bool heightAt(float x, float z, float& height) const;
+    // Nearest t in [0, maxDistance] at which the world-space ray origin +
+    // t * direction meets the rendered surface; false if it misses
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& t) const;
+
+    // Axis-aligned bounds of the generated vertices (before TERRAIN_HEIGHT_SCALE)
+    const glm::vec3& getBoundsMin() const { return boundsMin; }
+    const glm::vec3& getBoundsMax() const { return boundsMax; }
+
+    // Largest absolute height any terrain can have, wherever it is generated
+    static float heightBound();
+
+
 private:
-    unsigned int VAO, VBO, EBO;
-    int indexCount;
+    // position (3), normal (3), texture coordinates (2), LOD morph target height (1)
+    static const int VertexFloats = 9;
+
+    // TERRAIN_VERTEX_COMPACT vertex. Position is rebuilt in the vertex shader
+    // from the grid coordinates and the terrain's origin and scale; heights are
+    // counted in steps of CompactHeightStep above heightBase.
+    struct CompactVertex {
+        unsigned short gridX, gridZ;
+        unsigned short height, morphHeight;
+        signed char normal[2];
+        unsigned short padding;
+    };
+
+    // Every terrain quantizes heights on the same global grid, so vertices
+    // shared by neighbouring terrains decode to exactly the same height
+    static const float CompactHeightStep;
+
+    unsigned int VAO = 0, VBO = 0;
+    // Shared with every other uploaded terrain of the same grid size
+    std::shared_ptr<SharedIndexBuffer> indexBuffer;
+    Terrain_Vertex_Format vertexFormat = TERRAIN_VERTEX_FULL;
+    int originX = 0, originZ = 0;
+    int gridWidth = 0, gridDepth = 0;
+    float gridScale = 1.0f;
+    float heightBase = 0.0f;
+    glm::vec3 boundsMin, boundsMax;
+    int dirtyBegin = 0, dirtyEnd = 0;
 
-    // Store vertex and index data
+    // Store vertex data
     std::vector<float> vertices;
-    std::vector<unsigned int> indices;
+    // Height ranges over the vertices' heights, for heightAt() and raycast()
+    HeightQuadtree heightTree;
 
     void setupBuffers();
-    void generateTerrain(int width, int depth, float scale);
+    // Re-sends rows [zBegin, zEnd) of the vertex buffer
+    void updateBuffers(int zBegin, int zEnd);
+    void releaseBuffers();
+    std::vector<CompactVertex> packCompactVertices(int zBegin, int zEnd);
+    void generateTerrain(int width, int depth, float scale, const NoiseContext& p);
+    void setVertex(int x, int z, float height, const glm::vec3& normal);
+    // Bounds, morph targets and the height quadtree from the vertices' heights
+    void buildMesh();
+    float vertexHeight(int x, int z) const { return vertices[(x + z * (gridWidth + 1)) * VertexFloats + 1]; }
+    // Height of vertex (x, z) on a grid twice as coarse
+    float morphTarget(int x, int z) const;
 };
-#endif
\ No newline at end of file
+#endif
@@ -5,9 +5,14 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform float lightIntensity;
+// Per-frame values shared by every program (FrameUniforms in frame_uniforms.h)
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 lightPos;
+    float lightIntensity;
+    vec3 viewPos;
+};
 
 void main() {
     // Ambient
@@ -2,21 +2,112 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in float aMorphHeight;
+
+// Compact vertex format (see Terrain_Vertex_Format in terrain.h)
+layout (location = 4) in vec2 aGrid;        // Grid coordinates within the terrain
+layout (location = 5) in vec2 aHeightSteps; // Height and morph target height in quantization steps
+layout (location = 6) in vec2 aOctNormal;   // Octahedral-encoded normal
+
+// Heightmap format: shared grid mesh (aGrid) instanced per terrain
+layout (location = 7) in vec4 aInstanceGrid;  // Grid origin x/z, world units per quad, texture layer
+layout (location = 8) in vec2 aInstanceMorph; // Morph range
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Per-frame values shared by every program (FrameUniforms in frame_uniforms.h)
+layout (std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    vec3 lightPos;
+    float lightIntensity;
+    vec3 viewPos;
+};
+uniform vec2 morphRange; // Distance where morphing toward the coarser LOD starts and ends
+
+const int VERTEX_FULL = 0;
+const int VERTEX_COMPACT = 1;
+const int VERTEX_HEIGHTMAP = 2;
+uniform int vertexFormat;
+
+uniform vec2 gridOrigin;         // Grid coordinates of the terrain's first vertex
+uniform vec2 gridSize;           // Quads along x and z
+uniform float gridScale;         // World units per quad
+uniform vec2 heightQuantization; // Height of step 0, height per step
+uniform sampler2DArray heightmaps;
+uniform sampler2DArray normalmaps; // Normal x and z
+
+float fetchHeight(ivec2 grid, int layer) {
+    return texelFetch(heightmaps, ivec3(grid, layer), 0).r;
+}
+
+// Height on the next coarser grid, interpolated along the coarse triangle the
+// vertex falls on (same rule as Terrain::generateTerrain)
+float fetchMorphHeight(ivec2 grid, int layer) {
+    ivec2 size = ivec2(gridSize);
+    bool oddX = (grid.x & 1) == 1 && grid.x < size.x;
+    bool oddZ = (grid.y & 1) == 1 && grid.y < size.y;
+    if (oddX && oddZ)
+        return 0.5 * (fetchHeight(grid + ivec2(1, -1), layer) + fetchHeight(grid + ivec2(-1, 1), layer));
+    if (oddX)
+        return 0.5 * (fetchHeight(grid - ivec2(1, 0), layer) + fetchHeight(grid + ivec2(1, 0), layer));
+    if (oddZ)
+        return 0.5 * (fetchHeight(grid - ivec2(0, 1), layer) + fetchHeight(grid + ivec2(0, 1), layer));
+    return fetchHeight(grid, layer);
+}
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+    float t = max(-n.y, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.z += n.z >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main() {
-    vec3 flatPos = aPos;
-    flatPos.y *= 0.2; // Reduce bumpiness by scaling down the y-coordinate
-    FragPos = vec3(model * vec4(flatPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    TexCoords = aTexCoords;
-    
+    vec3 pos;
+    vec3 normal;
+    float morphHeight;
+    vec2 morphDistances = morphRange;
+    if (vertexFormat == VERTEX_HEIGHTMAP) {
+        ivec2 grid = ivec2(aGrid);
+        int layer = int(aInstanceGrid.w);
+        vec2 xz = (aInstanceGrid.xy + aGrid) * aInstanceGrid.z;
+        pos = vec3(xz.x, fetchHeight(grid, layer), xz.y);
+        morphHeight = fetchMorphHeight(grid, layer);
+        morphDistances = aInstanceMorph;
+        vec2 nxz = texelFetch(normalmaps, ivec3(grid, layer), 0).rg;
+        normal = vec3(nxz.x, sqrt(max(1.0 - dot(nxz, nxz), 0.0)), nxz.y);
+        TexCoords = aGrid / gridSize;
+    }
+    else if (vertexFormat == VERTEX_COMPACT) {
+        vec2 xz = (gridOrigin + aGrid) * gridScale;
+        vec2 heights = heightQuantization.x + aHeightSteps * heightQuantization.y;
+        pos = vec3(xz.x, heights.x, xz.y);
+        morphHeight = heights.y;
+        normal = decodeOctahedral(aOctNormal);
+        TexCoords = aGrid / gridSize;
+    }
+    else {
+        pos = aPos;
+        morphHeight = aMorphHeight;
+        normal = aNormal;
+        TexCoords = aTexCoords;
+    }
+
+    vec3 flatPos = pos;
+    if (morphDistances.y > morphDistances.x) {
+        // Blend toward the next coarser grid as the vertex nears the end of its LOD range
+        float dist = distance(pos.xz, viewPos.xz);
+        float morph = clamp((dist - morphDistances.x) / (morphDistances.y - morphDistances.x), 0.0, 1.0);
+        flatPos.y = mix(pos.y, morphHeight, morph);
+    }
+    flatPos.y *= 0.2; // Reduce bumpiness by scaling down the y-coordinate (TERRAIN_HEIGHT_SCALE in terrain.h)
+    // Chunks are generated in world space, so there is no model transform
+    FragPos = flatPos;
+    Normal = normal;
+
     gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,284 @@
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "text.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+#include "cache_file.h"
+#include "gl_buffer.h"
+
+namespace {
+
+const std::uint32_t Magic = 0x41544c53; // "ATLS"
+
+// Distance field encoding: texels within Padding pixels of a glyph's outline
+// (at the size it is generated at) hold the signed distance to it, with the
+// outline itself at OnEdge
+const int Padding = 4;
+const unsigned char OnEdge = 128;
+const float PixelDistanceScale = static_cast<float>(OnEdge) / Padding;
+
+struct AtlasHeader {
+    std::uint32_t magic;
+    std::uint32_t atlasSize;
+    std::uint64_t key;
+    float lineAdvance;
+    std::uint32_t padding;
+};
+
+} // namespace
+
+TextRenderer::TextRenderer(Shader& shader, const char* fontPath) : shader(shader) {
+    std::ifstream fontFile(fontPath, std::ios::binary);
+    std::vector<unsigned char> fontData((std::istreambuf_iterator<char>(fontFile)),
+        std::istreambuf_iterator<char>());
+    if (fontData.empty())
+        return;
+
+    // The cache entry is named after the font's contents and everything that
+    // shapes the atlas, so a different font or encoding never matches
+    const int layout[] = { FirstChar, CharCount, GlyphSize, Padding, OnEdge };
+    std::uint64_t key = fnv1a(fontData.data(), fontData.size());
+    key = fnv1a(layout, sizeof(layout), key);
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.atlas", static_cast<unsigned long long>(key));
+    std::string cachePath = std::string(TEXT_ATLAS_CACHE_DIRECTORY) + name;
+
+    std::vector<unsigned char> bitmap;
+    cached = loadAtlas(cachePath, key, bitmap);
+    if (!cached) {
+        if (!buildAtlas(fontData, bitmap))
+            return;
+        storeAtlas(cachePath, key, bitmap);
+    }
+
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasSize, atlasSize, 0, GL_RED, GL_UNSIGNED_BYTE, bitmap.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+}
+
+TextRenderer::~TextRenderer() {
+    if (!loaded())
+        return;
+    glDeleteTextures(1, &textureID);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteVertexArrays(1, &VAO);
+}
+
+bool TextRenderer::buildAtlas(const std::vector<unsigned char>& fontData, std::vector<unsigned char>& bitmap) {
+    stbtt_fontinfo font;
+    if (!stbtt_InitFont(&font, fontData.data(), stbtt_GetFontOffsetForIndex(fontData.data(), 0)))
+        return false;
+    float scale = stbtt_ScaleForPixelHeight(&font, static_cast<float>(GlyphSize));
+    int ascent, descent, lineGap;
+    stbtt_GetFontVMetrics(&font, &ascent, &descent, &lineGap);
+    lineAdvance = (ascent - descent + lineGap) * scale;
+
+    struct Field {
+        unsigned char* pixels;
+        int width, height;
+    };
+    Field fields[CharCount];
+    for (int i = 0; i < CharCount; ++i) {
+        int xoff = 0, yoff = 0, advance, leftBearing;
+        Field& field = fields[i];
+        field.width = field.height = 0;
+        // Null (and no size) for glyphs with no outline, such as the space
+        field.pixels = stbtt_GetCodepointSDF(&font, scale, FirstChar + i, Padding, OnEdge, PixelDistanceScale,
+            &field.width, &field.height, &xoff, &yoff);
+        stbtt_GetCodepointHMetrics(&font, FirstChar + i, &advance, &leftBearing);
+        glyphs[i].xoff = static_cast<float>(xoff);
+        glyphs[i].yoff = static_cast<float>(yoff);
+        glyphs[i].advance = advance * scale;
+    }
+
+    // Shelf packing into the smallest power-of-two square that fits: glyphs
+    // left to right in rows as tall as their tallest glyph
+    bool packed = false;
+    for (atlasSize = 128; atlasSize <= 4096; atlasSize *= 2) {
+        int x = 0, y = 0, rowHeight = 0;
+        packed = true;
+        for (int i = 0; i < CharCount && packed; ++i) {
+            const Field& field = fields[i];
+            if (x + field.width > atlasSize) {
+                x = 0;
+                y += rowHeight + 1;
+                rowHeight = 0;
+            }
+            packed = field.width <= atlasSize && y + field.height <= atlasSize;
+            glyphs[i].x0 = static_cast<unsigned short>(x);
+            glyphs[i].y0 = static_cast<unsigned short>(y);
+            glyphs[i].x1 = static_cast<unsigned short>(x + field.width);
+            glyphs[i].y1 = static_cast<unsigned short>(y + field.height);
+            x += field.width + 1;
+            rowHeight = std::max(rowHeight, field.height);
+        }
+        if (packed)
+            break;
+    }
+
+    if (packed) {
+        bitmap.assign(static_cast<size_t>(atlasSize) * atlasSize, 0);
+        for (int i = 0; i < CharCount; ++i) {
+            const Field& field = fields[i];
+            for (int row = 0; row < field.height; ++row)
+                std::memcpy(&bitmap[(glyphs[i].y0 + row) * static_cast<size_t>(atlasSize) + glyphs[i].x0],
+                    field.pixels + row * field.width, field.width);
+        }
+    }
+    for (const Field& field : fields)
+        stbtt_FreeSDF(field.pixels, nullptr);
+    return packed;
+}
+
+bool TextRenderer::loadAtlas(const std::string& path, std::uint64_t key, std::vector<unsigned char>& bitmap) {
+    std::ifstream file(path, std::ios::binary);
+    AtlasHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != Magic
+        || header.key != key || header.atlasSize == 0 || header.atlasSize > 4096)
+        return false;
+
+    atlasSize = header.atlasSize;
+    lineAdvance = header.lineAdvance;
+    bitmap.resize(static_cast<size_t>(atlasSize) * atlasSize);
+    return file.read(reinterpret_cast<char*>(glyphs), sizeof(glyphs))
+        && file.read(reinterpret_cast<char*>(bitmap.data()), bitmap.size());
+}
+
+void TextRenderer::storeAtlas(const std::string& path, std::uint64_t key, const std::vector<unsigned char>& bitmap) const {
+#ifdef _WIN32
+    _mkdir(TEXT_ATLAS_CACHE_DIRECTORY);
+#else
+    mkdir(TEXT_ATLAS_CACHE_DIRECTORY, 0755);
+#endif
+
+    AtlasHeader header;
+    header.magic = Magic;
+    header.atlasSize = atlasSize;
+    header.key = key;
+    header.lineAdvance = lineAdvance;
+    header.padding = 0;
+
+    // The glyph metrics follow the header, then the bitmap
+    std::vector<unsigned char> payload(sizeof(glyphs) + bitmap.size());
+    std::memcpy(payload.data(), glyphs, sizeof(glyphs));
+    std::memcpy(payload.data() + sizeof(glyphs), bitmap.data(), bitmap.size());
+    atomicWriteFile(path, &header, sizeof(header), payload.data(), payload.size());
+}
+
+void TextRenderer::add(const std::string& text, float x, float y, float size, const glm::vec4& color) {
+    if (!loaded())
+        return;
+
+    Vertex vertex;
+    for (int i = 0; i < 4; ++i)
+        vertex.color[i] = static_cast<unsigned char>(glm::clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+    float scale = size / GlyphSize;
+    float texel = 1.0f / atlasSize;
+    float penX = x, penY = y;
+    for (char c : text) {
+        if (c == '\n') {
+            penX = x;
+            penY += lineHeight(size);
+            continue;
+        }
+        if (c < FirstChar || c >= FirstChar + CharCount)
+            c = '?';
+
+        const Glyph& glyph = glyphs[c - FirstChar];
+        float x0 = penX + glyph.xoff * scale;
+        float y0 = penY + glyph.yoff * scale;
+        float x1 = x0 + (glyph.x1 - glyph.x0) * scale;
+        float y1 = y0 + (glyph.y1 - glyph.y0) * scale;
+        penX += glyph.advance * scale;
+        if (glyph.x1 == glyph.x0)
+            continue;
+        float s0 = glyph.x0 * texel, t0 = glyph.y0 * texel, s1 = glyph.x1 * texel, t1 = glyph.y1 * texel;
+        const float corners[4][4] = {
+            { x0, y0, s0, t0 }, { x0, y1, s0, t1 }, { x1, y1, s1, t1 }, { x1, y0, s1, t0 },
+        };
+        for (const auto& corner : corners) {
+            vertex.x = corner[0];
+            vertex.y = corner[1];
+            vertex.s = corner[2];
+            vertex.t = corner[3];
+            vertices.push_back(vertex);
+        }
+    }
+}
+
+void TextRenderer::reserve(size_t glyphCount) {
+    if (glyphCount <= capacity)
+        return;
+    capacity = std::max(glyphCount, capacity * 2);
+
+    // The index pattern never changes, so it is only written when the buffer grows
+    std::vector<unsigned int> indices;
+    indices.reserve(capacity * 6);
+    for (unsigned int i = 0; i < capacity; ++i) {
+        unsigned int base = i * 4;
+        for (unsigned int corner : { 0u, 1u, 2u, 0u, 2u, 3u })
+            indices.push_back(base + corner);
+    }
+    glBindVertexArray(VAO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+}
+
+void TextRenderer::draw(int viewportWidth, int viewportHeight) {
+    if (vertices.empty())
+        return;
+
+    size_t glyphCount = vertices.size() / 4;
+    reserve(glyphCount);
+
+    orphanAndUpload(GL_ARRAY_BUFFER, VBO, vertices.size() * sizeof(Vertex), vertices.data());
+    vertices.clear();
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    shader.use();
+    shader.setVec2("viewportSize", static_cast<float>(viewportWidth), static_cast<float>(viewportHeight));
+    shader.setInt("atlas", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+
+    glBindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(glyphCount * 6), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+
+    glDisable(GL_BLEND);
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+}
@@ -1,67 +1,93 @@
-// Include stb_truetype.h in your project
-#define STB_TRUETYPE_IMPLEMENTATION
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "shader.h"
 #include "stb_truetype.h"
 
-// Assuming you have a shader that can render text
-Shader textShader("text_vertex.glsl", "text_fragment.glsl");
-
-unsigned int VAO, VBO, textureID;
-stbtt_bakedchar cdata[96]; // ASCII 32..126 is 95 glyphs
-
-void initTextRendering() {
-    // Load font
-    std::ifstream fontFile("path/to/font.ttf", std::ios::binary);
-    std::vector<unsigned char> fontData((std::istreambuf_iterator<char>(fontFile)),
-        std::istreambuf_iterator<char>());
-
-    stbtt_BakeFontBitmap(fontData.data(), 0, 48.0f, bitmap, 512, 512, 32, 96, cdata); // Bake font
-
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, 512, 512, 0, GL_RED, GL_UNSIGNED_BYTE, bitmap);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, nullptr, GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-}
-
-void renderText(const std::string& text, float x, float y, float scale, glm::vec3 color) {
-    textShader.use();
-    textShader.setVec3("textColor", color);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-
-    glBindVertexArray(VAO);
-
-    for (char c : text) {
-        stbtt_bakedchar& ch = cdata[c - 32];
-
-        float xpos = x + ch.xoff * scale;
-        float ypos = y - (ch.yoff - ch.height) * scale;
-
-        float w = ch.xadvance * scale;
-        float h = ch.height * scale;
-
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-            { xpos,     ypos,       0.0f, 1.0f },
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos + h,   1.0f, 0.0f },
-            { xpos + w, ypos,       1.0f, 1.0f }
-        };
-
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        x += (ch.xadvance) * scale; // Advance cursor for next character
-    }
-}
+// Monospaced font for on-screen text
+#ifdef _WIN32
+const char* const TEXT_FONT_PATH = "C:/Windows/Fonts/consola.ttf";
+#else
+const char* const TEXT_FONT_PATH = "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf";
+#endif
+
+// Glyph atlases are saved here, one file per font, so later runs upload the
+// atlas without generating any glyphs
+const char* const TEXT_ATLAS_CACHE_DIRECTORY = "font_cache";
+
+// Draws ASCII text in screen space. Strings are queued with add() during the
+// frame; draw() then uploads the quads of all of them into one orphaned vertex
+// buffer and draws them with a single call.
+//
+// The atlas holds a signed distance field of each glyph (stbtt_GetCodepointSDF)
+// rather than its coverage, and the fragment shader thresholds the filtered
+// distance, so one atlas and one shader give sharp text at any size. It is
+// generated the first time a font is used and cached in
+// TEXT_ATLAS_CACHE_DIRECTORY after that.
+class TextRenderer {
+public:
+    // shader: text_vertex.glsl / text_fragment.glsl. If the font cannot be
+    // read, loaded() is false and nothing is drawn.
+    TextRenderer(Shader& shader, const char* fontPath);
+    ~TextRenderer();
+
+    TextRenderer(const TextRenderer&) = delete;
+    TextRenderer& operator=(const TextRenderer&) = delete;
+
+    bool loaded() const { return textureID != 0; }
+    // Baseline to baseline distance of text size pixels high
+    float lineHeight(float size) const { return lineAdvance * size / GlyphSize; }
+    // Whether the atlas came from the disk cache
+    bool atlasCached() const { return cached; }
+
+    // Queues text size pixels high (ascender to descender) with its first
+    // baseline at (x, y), in pixels from the top left of the viewport. '\n'
+    // starts a new line.
+    void add(const std::string& text, float x, float y, float size, const glm::vec4& color);
+    // Draws everything queued since the last draw() in one call, over the
+    // scene (it sets up blending and turns depth testing off for the draw)
+    void draw(int viewportWidth, int viewportHeight);
+
+private:
+    static const int FirstChar = 32;
+    static const int CharCount = 95; // ASCII 32..126
+    // Pixel height the distance fields are generated at
+    static const int GlyphSize = 32;
+
+    // Atlas rectangle of a glyph and its placement, in GlyphSize pixels
+    struct Glyph {
+        unsigned short x0, y0, x1, y1;
+        float xoff, yoff;
+        float advance;
+    };
+
+    // Position in pixels, atlas coordinates and colour of a glyph corner
+    struct Vertex {
+        float x, y, s, t;
+        unsigned char color[4];
+    };
+
+    Shader& shader;
+    bool cached = false;
+    int atlasSize = 0;
+    float lineAdvance = 0.0f; // in GlyphSize pixels
+    Glyph glyphs[CharCount];
+    unsigned int VAO = 0, VBO = 0, EBO = 0, textureID = 0;
+    // Glyphs the buffers have room for
+    size_t capacity = 0;
+    // This frame's quads, four vertices each
+    std::vector<Vertex> vertices;
+
+    // Renders every glyph's distance field and packs them into bitmap
+    bool buildAtlas(const std::vector<unsigned char>& fontData, std::vector<unsigned char>& bitmap);
+    bool loadAtlas(const std::string& path, std::uint64_t key, std::vector<unsigned char>& bitmap);
+    void storeAtlas(const std::string& path, std::uint64_t key, const std::vector<unsigned char>& bitmap) const;
+    void reserve(size_t glyphCount);
+};
+
+#endif // TEXT_H
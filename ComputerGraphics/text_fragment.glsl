@@ -0,0 +1,16 @@
+#version 330 core
+in vec2 TexCoord;
+in vec4 Color;
+out vec4 FragColor;
+
+uniform sampler2D atlas;
+
+void main()
+{
+    // The atlas holds each glyph's signed distance field, with the outline at
+    // 0.5; blend across about one screen pixel of distance at any text size
+    float distance = texture(atlas, TexCoord).r;
+    float width = max(fwidth(distance), 1e-4) * 0.5;
+    float coverage = smoothstep(0.5 - width, 0.5 + width, distance);
+    FragColor = vec4(Color.rgb, Color.a * coverage);
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec4 vertex; // xy: position in pixels from the top left, zw: atlas coordinates
+layout (location = 1) in vec4 aColor;
+
+uniform vec2 viewportSize;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+void main()
+{
+    vec2 ndc = vertex.xy / viewportSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    TexCoord = vertex.zw;
+    Color = aColor;
+}
\ No newline at end of file
@@ -0,0 +1,277 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "tile_cache.h"
+#include "cache_file.h"
+#include "terrain.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::uint32_t Magic = 0x454c4954; // "TILE"
+
+struct TileHeader {
+    std::uint32_t magic;
+    std::uint32_t version; // Terrain::GeneratorVersion
+    std::uint32_t seed;
+    float scale;
+    std::int32_t originX, originZ;
+    std::int32_t width, depth;
+    std::uint64_t checksum; // Of everything after the header
+};
+static_assert(sizeof(TileHeader) % 8 == 0, "tile payload must stay aligned");
+
+// FNV-1a over 64-bit words (then fnv1a over the tail bytes), fast enough to
+// verify a tile in a few microseconds
+std::uint64_t checksum(const unsigned char* data, size_t size) {
+    std::uint64_t hash = FnvOffsetBasis;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash ^= word;
+        hash *= FnvPrime;
+    }
+    return fnv1a(data + i, size - i, hash);
+}
+
+// Read-only mapping of a whole file; data() is null if it can't be mapped
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            return;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL)
+            return;
+        view = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (view)
+            length = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                view = static_cast<const unsigned char*>(address);
+                length = static_cast<size_t>(info.st_size);
+            }
+        }
+        close(fd); // The mapping stays valid
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (view)
+            UnmapViewOfFile(view);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (view)
+            munmap(const_cast<unsigned char*>(view), length);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return view; }
+    size_t size() const { return length; }
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#endif
+    const unsigned char* view = nullptr;
+    size_t length = 0;
+};
+
+// A file in the cache directory
+struct DirectoryEntry {
+    std::string name;
+    std::uint64_t size;
+    long long modified; // in the platform's own units; only compared
+};
+
+std::vector<DirectoryEntry> listFiles(const std::string& directory) {
+    std::vector<DirectoryEntry> files;
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE)
+        return files;
+    do {
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            continue;
+        DirectoryEntry entry;
+        entry.name = data.cFileName;
+        entry.size = (static_cast<std::uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+        entry.modified = (static_cast<long long>(data.ftLastWriteTime.dwHighDateTime) << 32)
+            | data.ftLastWriteTime.dwLowDateTime;
+        files.push_back(entry);
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (!dir)
+        return files;
+    while (dirent* d = readdir(dir)) {
+        struct stat info;
+        std::string path = directory + "/" + d->d_name;
+        if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+            continue;
+        DirectoryEntry entry;
+        entry.name = d->d_name;
+        entry.size = static_cast<std::uint64_t>(info.st_size);
+        entry.modified = static_cast<long long>(info.st_mtime);
+        files.push_back(entry);
+    }
+    closedir(dir);
+#endif
+    return files;
+}
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::uint32_t floatBits(float f) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+} // namespace
+
+TileCache::TileCache(unsigned int seed, const std::string& directory, std::uint64_t maxBytes)
+    : seed(seed), directory(directory) {
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+    prune(maxBytes);
+}
+
+void TileCache::prune(std::uint64_t maxBytes) {
+    std::vector<DirectoryEntry> tiles;
+    std::uint64_t total = 0;
+    for (DirectoryEntry& entry : listFiles(directory)) {
+        if (endsWith(entry.name, ".tile")) {
+            total += entry.size;
+            tiles.push_back(entry);
+        }
+    }
+    if (total <= maxBytes)
+        return;
+
+    // Tiles of other seeds go first, then the oldest written. Down to three
+    // quarters of the cap, so the next runs don't each delete a few tiles.
+    char prefix[16];
+    std::snprintf(prefix, sizeof(prefix), "%08x_", seed);
+    auto otherSeed = [&prefix](const DirectoryEntry& e) { return e.name.compare(0, 9, prefix) != 0; };
+    std::sort(tiles.begin(), tiles.end(), [&](const DirectoryEntry& a, const DirectoryEntry& b) {
+        if (otherSeed(a) != otherSeed(b))
+            return otherSeed(a);
+        return a.modified < b.modified;
+    });
+
+    std::uint64_t target = maxBytes / 4 * 3;
+    int removed = 0;
+    for (const DirectoryEntry& tile : tiles) {
+        if (total <= target)
+            break;
+        if (std::remove((directory + "/" + tile.name).c_str()) == 0) {
+            total -= tile.size;
+            ++removed;
+        }
+    }
+    LOG(LOG_INFO) << "Tile cache over " << maxBytes / (1024 * 1024) << " MB: removed " << removed << " tiles";
+}
+
+std::string TileCache::tilePath(int width, int depth, float scale, int originX, int originZ) const {
+    char name[96];
+    std::snprintf(name, sizeof(name), "/%08x_%08x_%d_%d_%dx%d.tile", seed, floatBits(scale),
+        originX, originZ, width, depth);
+    return directory + name;
+}
+
+std::unique_ptr<Terrain> TileCache::load(int width, int depth, float scale, int originX, int originZ) {
+    MappedFile file(tilePath(width, depth, scale, originX, originZ));
+
+    size_t vertexCount = static_cast<size_t>(width + 1) * (depth + 1);
+    size_t payloadSize = vertexCount * 3 * sizeof(float);
+    TileHeader header;
+    if (!file.data() || file.size() != sizeof(TileHeader) + payloadSize) {
+        ++missCount;
+        return nullptr;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    const unsigned char* payload = file.data() + sizeof(TileHeader);
+    if (header.magic != Magic || header.version != Terrain::GeneratorVersion || header.seed != seed
+        || floatBits(header.scale) != floatBits(scale) || header.originX != originX || header.originZ != originZ
+        || header.width != width || header.depth != depth || header.checksum != checksum(payload, payloadSize)) {
+        ++missCount;
+        return nullptr;
+    }
+
+    // The header is a multiple of 8 bytes and mappings are page-aligned, so
+    // the arrays can be read in place
+    const float* heights = reinterpret_cast<const float*>(payload);
+    const float* normals = heights + vertexCount;
+    ++hitCount;
+    return std::unique_ptr<Terrain>(new Terrain(width, depth, scale, originX, originZ, heights, normals));
+}
+
+void TileCache::store(const Terrain& terrain) {
+    std::vector<float> heights = terrain.getHeights();
+    std::vector<float> normals = terrain.getNormalsXZ();
+    std::vector<unsigned char> payload((heights.size() + normals.size()) * sizeof(float));
+    std::memcpy(payload.data(), heights.data(), heights.size() * sizeof(float));
+    std::memcpy(payload.data() + heights.size() * sizeof(float), normals.data(), normals.size() * sizeof(float));
+
+    TileHeader header;
+    header.magic = Magic;
+    header.version = Terrain::GeneratorVersion;
+    header.seed = seed;
+    header.scale = terrain.getGridScale();
+    header.originX = terrain.getOriginX();
+    header.originZ = terrain.getOriginZ();
+    header.width = terrain.getGridWidth();
+    header.depth = terrain.getGridDepth();
+    header.checksum = checksum(payload.data(), payload.size());
+
+    std::string path = tilePath(header.width, header.depth, header.scale, header.originX, header.originZ);
+    if (!atomicWriteFile(path, &header, sizeof(header), payload.data(), payload.size())) {
+        // Usually every store fails the same way (e.g. a read-only directory)
+        static LogRateLimit failureLog(5.0);
+        LOG_LIMITED(LOG_WARNING, failureLog) << "Could not write terrain tile " << path;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class Terrain;
+
+// On-disk cache of generated terrain tiles, so areas seen on an earlier run
+// are read back instead of evaluating the noise again. Each tile is one file
+// in the cache directory, named after the noise seed, grid scale, grid origin
+// and size that produced it:
+//
+//     header (TileHeader in tile_cache.cpp)
+//     heights     (width + 1) * (depth + 1) floats, row by row
+//     normals     x and z per vertex, interleaved (y is rebuilt)
+//
+// Files are memory-mapped for reading and the payload checksum is verified
+// before use; a missing, truncated, corrupt or stale tile (one written by an
+// older Terrain::GeneratorVersion) is a miss, and the regenerated tile simply
+// replaces it. Writes go to a temporary file that is renamed into place, so a
+// crash never leaves a half-written tile behind.
+//
+// The directory is capped in size: when a cache is created over a directory
+// holding more than maxBytes of tiles, tiles of other seeds are deleted first,
+// then the oldest written, so switching seeds never fills the disk.
+//
+// load() and store() may be called from any number of threads, as long as no
+// two of them work on the same tile at once.
+const char* const TERRAIN_CACHE_DIRECTORY = "terrain_cache";
+const std::uint64_t TERRAIN_CACHE_MAX_BYTES = 256ull * 1024 * 1024;
+
+class TileCache {
+public:
+    explicit TileCache(unsigned int seed, const std::string& directory = TERRAIN_CACHE_DIRECTORY,
+        std::uint64_t maxBytes = TERRAIN_CACHE_MAX_BYTES);
+
+    // The tile generated by Terrain(width, depth, scale, originX, originZ,
+    // noise) for this cache's seed, or null if it isn't cached
+    std::unique_ptr<Terrain> load(int width, int depth, float scale, int originX, int originZ);
+    void store(const Terrain& terrain);
+
+    int hits() const { return hitCount; }
+    int misses() const { return missCount; }
+
+private:
+    unsigned int seed;
+    std::string directory;
+    std::atomic<int> hitCount{ 0 };
+    std::atomic<int> missCount{ 0 };
+
+    std::string tilePath(int width, int depth, float scale, int originX, int originZ) const;
+    // Deletes tiles until the directory holds well under maxBytes of them
+    void prune(std::uint64_t maxBytes);
+};
+
+#endif // TILE_CACHE_H
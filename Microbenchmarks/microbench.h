@@ -0,0 +1,217 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+// Minimal microbenchmark harness modelled on Google Benchmark's API, so the
+// suite builds with nothing but the standard library:
+//
+//     void BM_Something(microbench::State& state) {
+//         for (auto _ : state)
+//             microbench::DoNotOptimize(work(state.range(0)));
+//         state.SetItemsProcessed(state.iterations() * state.range(0));
+//     }
+//     MICROBENCHMARK(BM_Something)->Range(64, 4096);
+//
+// Each benchmark runs with a growing iteration count until one batch takes at
+// least --benchmark_min_time seconds, then reports time per iteration and
+// items (or bytes) per second.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace microbench {
+
+class State {
+public:
+    State(long long iterations, const std::vector<long long>& args)
+        : maxIterations(iterations), args(args) {
+    }
+
+    // Range-for support: for (auto _ : state) runs iterations() times and
+    // times only the loop. The loop variable has a user-provided constructor
+    // and destructor so compilers don't warn that it is unused.
+    struct Value {
+        Value() {}
+        ~Value() {}
+    };
+    struct Iterator {
+        State* state;
+        long long remaining;
+        bool operator!=(const Iterator&) {
+            if (remaining > 0)
+                return true;
+            state->stop = Clock::now();
+            return false;
+        }
+        void operator++() { --remaining; }
+        Value operator*() const { return Value(); }
+    };
+    Iterator begin() {
+        start = Clock::now();
+        return Iterator{ this, maxIterations };
+    }
+    Iterator end() { return Iterator{ this, 0 }; }
+
+    long long range(size_t i = 0) const { return args[i]; }
+    long long iterations() const { return maxIterations; }
+
+    void SetItemsProcessed(long long items) { itemsProcessed = items; }
+    void SetBytesProcessed(long long bytes) { bytesProcessed = bytes; }
+
+    double seconds() const { return std::chrono::duration<double>(stop - start).count(); }
+    long long items() const { return itemsProcessed; }
+    long long bytes() const { return bytesProcessed; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    long long maxIterations;
+    std::vector<long long> args;
+    Clock::time_point start, stop;
+    long long itemsProcessed = 0;
+    long long bytesProcessed = 0;
+};
+
+// Keeps the compiler from optimizing away a result that is never used
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const char* sink;
+    sink = reinterpret_cast<const volatile char*>(&value);
+#endif
+}
+
+typedef void (*Function)(State&);
+
+class Benchmark {
+public:
+    Benchmark(const char* name, Function fn) : name(name), fn(fn) {
+    }
+
+    Benchmark* Arg(long long a) {
+        argSets.push_back(std::vector<long long>(1, a));
+        return this;
+    }
+    Benchmark* Args(const std::vector<long long>& a) {
+        argSets.push_back(a);
+        return this;
+    }
+    // lo, every power of multiplier in between, and hi
+    Benchmark* Range(long long lo, long long hi, long long multiplier = 4) {
+        for (long long a = lo; a < hi; a *= multiplier)
+            Arg(a);
+        return Arg(hi);
+    }
+
+    std::string name;
+    Function fn;
+    std::vector<std::vector<long long>> argSets;
+};
+
+inline std::vector<Benchmark*>& registry() {
+    static std::vector<Benchmark*> benchmarks;
+    return benchmarks;
+}
+
+inline Benchmark* registerBenchmark(const char* name, Function fn) {
+    registry().push_back(new Benchmark(name, fn));
+    return registry().back();
+}
+
+struct Result {
+    std::string name;
+    long long iterations;
+    double nsPerIteration;
+    double itemsPerSecond;
+    double bytesPerSecond;
+};
+
+inline Result run(const std::string& name, Function fn, const std::vector<long long>& args, double minTime) {
+    long long iterations = 1;
+    while (true) {
+        State state(iterations, args);
+        fn(state);
+        double seconds = state.seconds();
+        if (seconds >= minTime || iterations >= 1000000000LL) {
+            Result r;
+            r.name = name;
+            r.iterations = iterations;
+            r.nsPerIteration = seconds * 1e9 / iterations;
+            r.itemsPerSecond = seconds > 0.0 ? state.items() / seconds : 0.0;
+            r.bytesPerSecond = seconds > 0.0 ? state.bytes() / seconds : 0.0;
+            return r;
+        }
+        // Aim a little past minTime next, growing at most 10x per step
+        double scale = seconds > 0.0 ? 1.4 * minTime / seconds : 10.0;
+        iterations = std::max(iterations + 1, static_cast<long long>(iterations * std::min(scale, 10.0)));
+    }
+}
+
+// Command line: --benchmark_filter=<substring> --benchmark_min_time=<seconds>
+// --benchmark_format=<console|json>
+inline int runAll(int argc, char* argv[]) {
+    std::string filter;
+    double minTime = 0.5;
+    bool json = false;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--benchmark_filter=", 19) == 0)
+            filter = arg + 19;
+        else if (std::strncmp(arg, "--benchmark_min_time=", 21) == 0)
+            minTime = std::atof(arg + 21);
+        else if (std::strcmp(arg, "--benchmark_format=json") == 0)
+            json = true;
+    }
+
+    std::vector<Result> results;
+    if (!json)
+        std::printf("%-40s %15s %12s %15s\n", "Benchmark", "Time (ns)", "Iterations", "Items/s");
+    for (Benchmark* b : registry()) {
+        std::vector<std::vector<long long>> argSets = b->argSets;
+        if (argSets.empty())
+            argSets.push_back(std::vector<long long>());
+        for (const std::vector<long long>& args : argSets) {
+            std::string name = b->name;
+            for (long long a : args)
+                name += "/" + std::to_string(a);
+            if (!filter.empty() && name.find(filter) == std::string::npos)
+                continue;
+
+            Result r = run(name, b->fn, args, minTime);
+            results.push_back(r);
+            if (!json) {
+                std::printf("%-40s %15.0f %12lld %15.4g\n", r.name.c_str(), r.nsPerIteration, r.iterations, r.itemsPerSecond);
+                std::fflush(stdout);
+            }
+        }
+    }
+
+    if (json) {
+        std::printf("{\n  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            std::printf("    { \"name\": \"%s\", \"iterations\": %lld, \"real_time_ns\": %.1f, "
+                "\"items_per_second\": %.6g, \"bytes_per_second\": %.6g }%s\n",
+                r.name.c_str(), r.iterations, r.nsPerIteration, r.itemsPerSecond, r.bytesPerSecond,
+                i + 1 < results.size() ? "," : "");
+        }
+        std::printf("  ]\n}\n");
+    }
+    return 0;
+}
+
+} // namespace microbench
+
+#define MICROBENCH_CONCAT2(a, b) a##b
+#define MICROBENCH_CONCAT(a, b) MICROBENCH_CONCAT2(a, b)
+#define MICROBENCHMARK(fn) \
+    static microbench::Benchmark* MICROBENCH_CONCAT(microbench_registration_, __LINE__) = \
+        microbench::registerBenchmark(#fn, fn)
+
+#endif // MICROBENCH_H
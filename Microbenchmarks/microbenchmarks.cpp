@@ -0,0 +1,188 @@
+// CPU-side microbenchmarks for noise, terrain and sphere generation and for
+// terrain edits and queries. None of them touch OpenGL, so the suite runs
+// without a window or GL context.
+
+#include "microbench.h"
+#include "perlin.h"
+#include "parallel.h"
+#include "terrain.h"
+#include "sphere.h"
+#include <cmath>
+#include <random>
+
+namespace {
+
+const unsigned int Seed = 404;
+
+const NoiseContext& noise() {
+    static const NoiseContext context(Seed);
+    return context;
+}
+
+// Scalar improved Perlin noise, one sample per call
+void BM_PerlinNoise(microbench::State& state) {
+    const NoiseContext& p = noise();
+    double x = 0.0;
+    for (auto _ : state) {
+        microbench::DoNotOptimize(perlin_noise(x, 0.37, 0.0, p));
+        x += 0.173;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+MICROBENCHMARK(BM_PerlinNoise);
+
+// SIMD batch noise over a row of range(0) samples
+void BM_PerlinNoiseBatch(microbench::State& state) {
+    const NoiseContext& p = noise();
+    int count = static_cast<int>(state.range(0));
+    std::vector<float> xs(count), ys(count, 0.37f), out(count);
+    for (int i = 0; i < count; ++i)
+        xs[i] = i * 0.173f;
+    for (auto _ : state) {
+        perlin_noise_batch(xs.data(), ys.data(), 0.0f, out.data(), count, p);
+        microbench::DoNotOptimize(out[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+MICROBENCHMARK(BM_PerlinNoiseBatch)->Arg(64)->Arg(1024);
+
+// The same with analytic derivatives, as terrain generation runs it
+void BM_PerlinNoiseBatchDeriv(microbench::State& state) {
+    const NoiseContext& p = noise();
+    int count = static_cast<int>(state.range(0));
+    std::vector<float> xs(count), ys(count, 0.37f), out(count), dx(count), dy(count);
+    for (int i = 0; i < count; ++i)
+        xs[i] = i * 0.173f;
+    for (auto _ : state) {
+        perlin_noise_batch_deriv(xs.data(), ys.data(), 0.0f, out.data(), dx.data(), dy.data(), count, p);
+        microbench::DoNotOptimize(out[0]);
+        microbench::DoNotOptimize(dx[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+MICROBENCHMARK(BM_PerlinNoiseBatchDeriv)->Arg(64)->Arg(1024);
+
+// Full generation of a range(0)^2-quad terrain (noise, vertices and morph
+// targets) on every core; items are vertices
+void BM_GenerateTerrain(microbench::State& state) {
+    int size = static_cast<int>(state.range(0));
+    for (auto _ : state) {
+        Terrain terrain(size, size, 10.0f, 0, 0, noise());
+        microbench::DoNotOptimize(terrain.getBoundsMax());
+    }
+    state.SetItemsProcessed(state.iterations() * (size + 1LL) * (size + 1LL));
+}
+MICROBENCHMARK(BM_GenerateTerrain)->Range(64, 4096);
+
+// The same on the calling thread only, as chunk streaming workers run it
+void BM_GenerateTerrainSerial(microbench::State& state) {
+    int size = static_cast<int>(state.range(0));
+    bool wasWorker = isWorkerThread();
+    isWorkerThread() = true;
+    for (auto _ : state) {
+        Terrain terrain(size, size, 10.0f, 0, 0, noise());
+        microbench::DoNotOptimize(terrain.getBoundsMax());
+    }
+    isWorkerThread() = wasWorker;
+    state.SetItemsProcessed(state.iterations() * (size + 1LL) * (size + 1LL));
+}
+MICROBENCHMARK(BM_GenerateTerrainSerial)->Range(64, 1024);
+
+// Brush edits with a radius of range(1) quads on a range(0)^2-quad terrain,
+// alternately raising and smoothing along its diagonal; items are edits. The
+// cost follows the brush's area, not the terrain's.
+void BM_TerrainEdit(microbench::State& state) {
+    int size = static_cast<int>(state.range(0));
+    Terrain terrain(size, size, 10.0f, 0, 0, noise());
+    TerrainBrush brush;
+    brush.radius = state.range(1) * 10.0f;
+    brush.strength = 0.5f;
+    int step = 0;
+    for (auto _ : state) {
+        brush.mode = (step & 1) ? TERRAIN_BRUSH_SMOOTH : TERRAIN_BRUSH_RAISE;
+        brush.x = brush.z = (step * 37 % size) * 10.0f;
+        microbench::DoNotOptimize(terrain.edit(brush));
+        ++step;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+MICROBENCHMARK(BM_TerrainEdit)->Args({ 256, 16 })->Args({ 2048, 16 })->Args({ 2048, 64 });
+
+// Rays cast from 100 units above a range(0)^2-quad terrain, 30 degrees below
+// the horizon in varying directions; items are rays. The quadtree keeps the
+// cost close to logarithmic in the terrain's size.
+void BM_TerrainRaycast(microbench::State& state) {
+    int size = static_cast<int>(state.range(0));
+    Terrain terrain(size, size, 10.0f, 0, 0, noise());
+    std::mt19937 random(Seed);
+    std::uniform_real_distribution<float> position(0.0f, size * 10.0f), angle(0.0f, 6.2831853f);
+    std::vector<glm::vec3> origins(1024), directions(1024);
+    for (size_t i = 0; i < origins.size(); ++i) {
+        float x = position(random), z = position(random), height = 0.0f;
+        terrain.heightAt(x, z, height);
+        origins[i] = glm::vec3(x, height + 100.0f, z);
+        float a = angle(random);
+        directions[i] = glm::vec3(std::cos(a) * 0.866f, -0.5f, std::sin(a) * 0.866f);
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        float t = 0.0f;
+        microbench::DoNotOptimize(terrain.raycast(origins[i], directions[i], 1e6f, t));
+        microbench::DoNotOptimize(t);
+        i = (i + 1) % origins.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+MICROBENCHMARK(BM_TerrainRaycast)->Arg(64)->Arg(512)->Arg(2048);
+
+// Height queries at scattered points of a 512^2-quad terrain; items are queries
+void BM_TerrainHeightAt(microbench::State& state) {
+    Terrain terrain(512, 512, 10.0f, 0, 0, noise());
+    float x = 0.0f, z = 0.0f;
+    for (auto _ : state) {
+        float height = 0.0f;
+        microbench::DoNotOptimize(terrain.heightAt(x, z, height));
+        microbench::DoNotOptimize(height);
+        x = std::fmod(x + 37.3f, 5120.0f);
+        z = std::fmod(z + 91.7f, 5120.0f);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+MICROBENCHMARK(BM_TerrainHeightAt);
+
+// Index buffer for a range(0)^2-quad grid in Grid_Index_Layout range(1); items are triangles
+void BM_GenerateGridIndices(microbench::State& state) {
+    int size = static_cast<int>(state.range(0));
+    Grid_Index_Layout layout = static_cast<Grid_Index_Layout>(state.range(1));
+    GridIndices indices;
+    for (auto _ : state) {
+        indices = GridIndices(size, size, layout);
+        microbench::DoNotOptimize(indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * 2LL * size * size);
+    state.SetBytesProcessed(state.iterations() * static_cast<long long>(indices.byteSize()));
+}
+MICROBENCHMARK(BM_GenerateGridIndices)
+    ->Args({ 32, GRID_INDEX_LIST })->Args({ 1024, GRID_INDEX_LIST })->Args({ 4096, GRID_INDEX_LIST })
+    ->Args({ 32, GRID_INDEX_STRIPS })->Args({ 1024, GRID_INDEX_STRIPS })->Args({ 4096, GRID_INDEX_STRIPS })
+    ->Args({ 32, GRID_INDEX_OPTIMIZED })->Args({ 256, GRID_INDEX_OPTIMIZED });
+
+// UV sphere with range(0) sectors and range(1) stacks; items are vertices
+void BM_SphereMesh(microbench::State& state) {
+    unsigned int sectors = static_cast<unsigned int>(state.range(0));
+    unsigned int stacks = static_cast<unsigned int>(state.range(1));
+    std::vector<glm::vec3> vertices;
+    std::vector<unsigned int> indices;
+    for (auto _ : state) {
+        Sphere::generateMesh(100.0f, sectors, stacks, vertices, indices);
+        microbench::DoNotOptimize(indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (sectors + 1LL) * (stacks + 1LL));
+}
+MICROBENCHMARK(BM_SphereMesh)->Args({ 36, 18 })->Args({ 256, 128 })->Args({ 1024, 512 });
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    return microbench::runAll(argc, argv);
+}
@@ -0,0 +1,133 @@
+// Checks the SIMD batch noise kernels against the scalar perlin_noise and
+// perlin_noise_deriv they reimplement. Every kernel the build has (AVX2, SSE2
+// and the scalar fallback) is run over random samples, in batch lengths that
+// leave every possible tail. Exits with 1 if any sample is off by more than
+// the tolerances.
+
+#include "perlin.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+const unsigned int Seed = 404;
+
+// The kernels work in single precision, the scalar reference in double. fade's
+// polynomial runs through intermediates near 10 to results near 1, so values
+// carry up to about 1.5e-6 of rounding without FMA. Derivatives add products
+// of fade_derivative (up to 1.875) and corner differences (up to about 2), and
+// get four times the room.
+const double Tolerance = 2e-6;
+const double DerivativeTolerance = 8e-6;
+
+// Batch lengths: whole SIMD blocks, every tail length for 8 and 4 lanes, and
+// batches shorter than one block
+const int Counts[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 11, 12, 13, 15, 16, 17, 31, 64, 100, 1023 };
+
+typedef void (*BatchFunction)(const float*, const float*, float, float*, int, const NoiseContext&);
+typedef void (*BatchDerivFunction)(const float*, const float*, float, float*, float*, float*, int,
+    const NoiseContext&);
+
+struct Samples {
+    std::vector<float> xs, ys;
+    float z;
+};
+
+// Sample coordinates over the range terrain generation uses, negative ones
+// included, and some on exact lattice points where the floor matters
+Samples randomSamples(std::mt19937& generator, int count) {
+    std::uniform_real_distribution<float> coordinate(-512.0f, 512.0f);
+    std::uniform_int_distribution<int> lattice(-256, 256);
+    Samples samples;
+    samples.xs.resize(count);
+    samples.ys.resize(count);
+    for (int i = 0; i < count; ++i) {
+        bool onLattice = generator() % 16 == 0;
+        samples.xs[i] = onLattice ? static_cast<float>(lattice(generator)) : coordinate(generator);
+        samples.ys[i] = onLattice ? static_cast<float>(lattice(generator)) : coordinate(generator);
+    }
+    samples.z = coordinate(generator);
+    return samples;
+}
+
+// Whether every batch result is within tolerance of the scalar one; prints
+// the largest errors and the first sample out of tolerance
+bool checkBatch(const char* name, BatchFunction batch, const NoiseContext& p, std::mt19937& generator) {
+    double worst = 0.0;
+    for (int count : Counts) {
+        for (int round = 0; round < 64; ++round) {
+            Samples s = randomSamples(generator, count);
+            std::vector<float> out(count);
+            batch(s.xs.data(), s.ys.data(), s.z, out.data(), count, p);
+            for (int i = 0; i < count; ++i) {
+                double expected = perlin_noise(s.xs[i], s.ys[i], s.z, p);
+                double error = std::abs(out[i] - expected);
+                if (error > Tolerance && worst <= Tolerance)
+                    std::printf("  %s: count %d, sample %d at (%.7g, %.7g, %.7g): %.9g, expected %.9g\n",
+                        name, count, i, s.xs[i], s.ys[i], s.z, out[i], expected);
+                worst = std::max(worst, error);
+            }
+        }
+    }
+
+    bool passed = worst <= Tolerance;
+    std::printf("%-32s max error %.3g  %s\n", name, worst, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+bool checkBatchDeriv(const char* name, BatchDerivFunction batch, const NoiseContext& p, std::mt19937& generator) {
+    double worst = 0.0, worstDerivative = 0.0;
+    for (int count : Counts) {
+        for (int round = 0; round < 64; ++round) {
+            Samples s = randomSamples(generator, count);
+            std::vector<float> out(count), dx(count), dy(count);
+            batch(s.xs.data(), s.ys.data(), s.z, out.data(), dx.data(), dy.data(), count, p);
+            for (int i = 0; i < count; ++i) {
+                double expectedDx, expectedDy;
+                double expected = perlin_noise_deriv(s.xs[i], s.ys[i], s.z, p, expectedDx, expectedDy);
+                double error = std::abs(out[i] - expected);
+                double derivativeError = std::max(std::abs(dx[i] - expectedDx), std::abs(dy[i] - expectedDy));
+                bool failedBefore = worst > Tolerance || worstDerivative > DerivativeTolerance;
+                if (!failedBefore && (error > Tolerance || derivativeError > DerivativeTolerance))
+                    std::printf("  %s: count %d, sample %d at (%.7g, %.7g, %.7g): %.9g (%.9g, %.9g), "
+                        "expected %.9g (%.9g, %.9g)\n", name, count, i, s.xs[i], s.ys[i], s.z,
+                        out[i], dx[i], dy[i], expected, expectedDx, expectedDy);
+                worst = std::max(worst, error);
+                worstDerivative = std::max(worstDerivative, derivativeError);
+            }
+        }
+    }
+
+    bool passed = worst <= Tolerance && worstDerivative <= DerivativeTolerance;
+    std::printf("%-32s max error %.3g, derivatives %.3g  %s\n", name, worst, worstDerivative,
+        passed ? "ok" : "FAILED");
+    return passed;
+}
+
+} // namespace
+
+int main() {
+    const NoiseContext p(Seed);
+    std::mt19937 generator(Seed);
+    bool passed = true;
+
+#if defined(PERLIN_SIMD_AVX2)
+    passed &= checkBatch("perlin_noise_batch_avx2", perlin_noise_batch_avx2, p, generator);
+    passed &= checkBatchDeriv("perlin_noise_batch_deriv_avx2", perlin_noise_batch_deriv_avx2, p, generator);
+#else
+    std::printf("AVX2 kernels not built (compile with /arch:AVX2 or -mavx2)\n");
+#endif
+#if defined(PERLIN_SIMD_SSE2)
+    passed &= checkBatch("perlin_noise_batch_sse2", perlin_noise_batch_sse2, p, generator);
+    passed &= checkBatchDeriv("perlin_noise_batch_deriv_sse2", perlin_noise_batch_deriv_sse2, p, generator);
+#else
+    std::printf("SSE2 kernels not built\n");
+#endif
+    passed &= checkBatch("perlin_noise_batch_scalar", perlin_noise_batch_scalar, p, generator);
+    passed &= checkBatchDeriv("perlin_noise_batch_deriv_scalar", perlin_noise_batch_deriv_scalar, p, generator);
+
+    return passed ? 0 : 1;
+}